@@ -1,3 +1,4 @@
+// Build: gcc -o gateway UDP.c rules.c source.c sample_queue.c gpio_cdev.c clock_sync.c comparator.c net_link.c board_table.c -lpthread
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,24 +6,240 @@
 #include <pthread.h>
 #include <arpa/inet.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <getopt.h>
+#include "rules.h"
+#include "source.h"
+#include "sample_queue.h"
+#include "gpio_cdev.h"
+#include "pump_telemetry.h"
+#include "clock_sync.h"
+#include "comparator.h"
+#include "net_link.h"
+#include "board_table.h"
+#include "gateway.h"
 
 #define DEVICE_PATH_HUMIDITY "/sys/class/gpio_class_humidity/gpio_char_device_humidity/"
 #define DEVICE_PATH_SALTINESS "/sys/class/gpio_class_saltiness/gpio_char_device_salt/"
 #define DEVICE_PATH_LIGHT "/sys/class/gpio_class_light/gpio_char_device_light/"
+#define DEVICE_PATH_PUMP "/sys/class/gpio_class_pump/gpio_char_device_pump/"
 
-#define MAX_CHANGES 10
 #define MONITOR_DURATION 10 // 10 seconds
-#define UDP_SERVER_IP "192.168.5.5"
+#define UDP_SERVER_IP "192.168.5.5" // Until --mcu or a board picked from the table
 #define UDP_SERVER_PORT 50007
+#define RULES_FILE "rules.conf"
+#define ALERT_IP "127.0.0.1" // Alerts go to a local listener, not to the board
+#define ALERT_PORT 50008
+#define QUEUE_CAPACITY 4096 // Samples buffered between ingestion and the writer
+#define WRITER_BATCH 64     // Samples stored per log rewrite
+#define FRAME_SLOT_US 50000 // Bit slot of the GPIO frames, bitDelay on the MCU (200 in its DMA mode)
+#define GPIO_LINES_PER_CHIP 32 // AM335x: global GPIO n is line n % 32 of gpiochip n / 32
+#define FETCH_MAX_ROUNDS 64    // The MCU caps each reply, keep asking until caught up
+#define SYNC_EXCHANGES 8       // Per sync round, the one with the shortest round trip is kept
+#define REPLY_TIMEOUT_MS 1000  // Longest wait for each reply datagram from the MCU
+#define NET_RCVBUF (256 * 1024) // Room for several full "fetch" replies, --rcvbuf
+#define BOARD_PROBE_MS 2000    // Discovery re-probe period, --probe-ms
+#define DISCOVERY_WAIT_MS 200  // Menu probe: how long newly powered boards get to answer
+#define MCU_TRACE_FILE "mcu_trace.txt" // Fetched MCU samples, on the gateway's CLOCK_MONOTONIC
+#define MAX_CONFIG_LEN 80          // "config" arguments typed at the menu, the MCU takes 100 bytes
+#define COMPARE_WORKERS 3         // Link check shards, sensors are spread over them
+#define COMPARE_TOLERANCE_MS 100  // GPIO vs MCU timestamp jitter accepted around the learned skew
+#define COMPARE_MAX_LATENCY_MS 500 // Longest GPIO path delay accepted before the skew is known, below the frame spacing
 
+// Used when RULES_FILE is missing: pump runs while humidity is below 4
+#define DEFAULT_RULES \
+    "water humidity < 4 -> pump_on\n" \
+    "dry humidity > 3 -> pump_off\n"
+
+// Per-sensor replay results, used to spot gaps, duplicates and reordering
+typedef struct {
+    unsigned long samples;
+    unsigned long gaps;
+    unsigned long duplicates;
+    unsigned long reordered;
+    uint32_t next_seq;
+    int seen;
+    unsigned min_value;
+    unsigned max_value;
+    unsigned long long value_sum;
+} ReplayStats;
+
+static int verbose = 1; // Replay turns off per-sample printing
+static FILE *record_trace = NULL; // --record: every live sample is appended here
+
+// Ingestion threads only push into the queue, the writer thread owns logs and traces
+static SampleQueue sample_queue;
+static atomic_int writer_running = 0;
+
+static RuleEngine rule_engine;
+static int alert_sockfd = -1;
+static struct sockaddr_in alert_addr;
+
+static int pump_state_fd = -1; // Kept open so actuation is a single pwrite(). The driver ignores
+                               // writes of the current state, and the button toggles it behind our back.
+
+static ClockSync mcu_clock; // MCU sample ticks -> CLOCK_MONOTONIC
+static Comparator comparator; // Live GPIO vs MCU link check, fed by ingestion and fetch
+static NetLink mcu_link; // Batched UDP socket to the MCU
+static BoardTable board_table; // Multicast discovery and "start" fan-out, its own socket
+
+// What the gateway learned about one MCU, parked while another board is selected
 typedef struct {
-    char *device_path;
-    char *log_file;
-    char *sensor_name;
-    char *changes[MAX_CHANGES];
-    int change_count;
-    int monitoring; // Flag to control monitoring
-} Device;
+    struct sockaddr_in addr;
+    ClockSync clock;
+    uint32_t remote_seq[SENSOR_COUNT];
+    unsigned long remote_lost[SENSOR_COUNT];
+    unsigned long remote_resets[SENSOR_COUNT];
+} BoardSession;
+
+static BoardSession board_sessions[BOARD_MAX];
+static int board_session_count;
+
+int pump_open() {
+    pump_state_fd = open(DEVICE_PATH_PUMP "state", O_RDWR);
+    if (pump_state_fd < 0) {
+        fprintf(stderr, "Error: Failed to open pump state file: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+void pump_set(int on) {
+    if (pump_state_fd < 0) {
+        return;
+    }
+    if (pwrite(pump_state_fd, on ? "1" : "0", 1, 0) != 1) {
+        fprintf(stderr, "Error: Failed to set pump state: %s\n", strerror(errno));
+    }
+}
+
+// The driver's current state, -1 if it can't be read
+int pump_get() {
+    char state[4];
+
+    if (pump_state_fd < 0 || pread(pump_state_fd, state, sizeof(state), 0) < 1) {
+        return -1;
+    }
+    return state[0] == '1';
+}
+
+// Called by the rules engine from the ingestion thread that completed a rule
+void run_rule_action(const Rule *rule, const Sample *sample, void *ctx) {
+    char message[96];
+    int length;
+
+    switch (rule->action) {
+    case ACTION_PUMP_ON:
+        pump_set(1);
+        break;
+    case ACTION_PUMP_OFF:
+        pump_set(0);
+        break;
+    case ACTION_PUMP_TOGGLE:
+        pump_set(pump_get() != 1);
+        break;
+    case ACTION_ALERT:
+        length = snprintf(message, sizeof(message), "alert %s %s %u", rule->name,
+                          sensor_to_name(sample->sensor), sample->value);
+        sendto(alert_sockfd, message, length, 0, (const struct sockaddr *)&alert_addr, sizeof(alert_addr));
+        break;
+    }
+    if (verbose) {
+        printf("Rule %s fired: %s\n", rule->name, rules_action_name(rule->action));
+    }
+}
+
+void load_rules() {
+    rules_init(&rule_engine, run_rule_action, NULL);
+    int count = rules_load(&rule_engine, RULES_FILE);
+    if (count < 0) {
+        count = rules_compile(&rule_engine, DEFAULT_RULES);
+        printf("Using built-in rules (%d), %s not loaded\n", count, RULES_FILE);
+    } else {
+        printf("Loaded %d rules from %s\n", count, RULES_FILE);
+    }
+
+    alert_sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(&alert_addr, 0, sizeof(alert_addr));
+    alert_addr.sin_family = AF_INET;
+    alert_addr.sin_port = htons(ALERT_PORT);
+    inet_pton(AF_INET, ALERT_IP, &alert_addr.sin_addr);
+}
+
+void print_pump_stats() {
+    FILE *state_file = fopen(DEVICE_PATH_PUMP "state", "r");
+    FILE *stats_file = fopen(DEVICE_PATH_PUMP "stats", "r");
+    unsigned long long on_us = 0, last_us = 0, total_us = 0;
+    unsigned int cycles = 0;
+    int state = 0;
+
+    if (!state_file || !stats_file ||
+        fscanf(state_file, "%d", &state) != 1 ||
+        fscanf(stats_file, "%llu %llu %llu %u", &on_us, &last_us, &total_us, &cycles) != 4) {
+        fprintf(stderr, "Error: Failed to read pump state\n");
+    } else {
+        printf("Pump is %s, current ON %llu us, last ON %llu us, total ON %llu us, %u cycles\n",
+               state ? "ON" : "OFF", on_us, last_us, total_us, cycles);
+    }
+    if (state_file) fclose(state_file);
+    if (stats_file) fclose(stats_file);
+}
+
+void print_pump_telemetry(const char *origin, const struct pump_telemetry *telemetry) {
+    double duty = telemetry->uptime_us ? 100.0 * telemetry->total_on_us / telemetry->uptime_us : 0.0;
+
+    printf("%s pump: %s, %u cycles, duty cycle %.3f%% (%llu of %llu us), current ON %llu us, last ON %llu us\n",
+           origin, telemetry->state ? "ON" : "OFF", telemetry->cycles, duty,
+           (unsigned long long)telemetry->total_on_us, (unsigned long long)telemetry->uptime_us,
+           (unsigned long long)telemetry->current_on_us, (unsigned long long)telemetry->last_on_us);
+    for (int i = 0; i < PUMP_HIST_BUCKETS; i++) {
+        if (telemetry->histogram[i] == 0) {
+            continue;
+        }
+        if (i == 0) {
+            printf("    < 1 ms: %u\n", telemetry->histogram[i]);
+        } else if (i == PUMP_HIST_BUCKETS - 1) {
+            printf("    >= %u ms: %u\n", 1u << (i - 1), telemetry->histogram[i]);
+        } else {
+            printf("    %u-%u ms: %u\n", 1u << (i - 1), 1u << i, telemetry->histogram[i]);
+        }
+    }
+}
+
+static int valid_telemetry(const struct pump_telemetry *telemetry, ssize_t bytes) {
+    return bytes == (ssize_t)sizeof(*telemetry) && memcmp(telemetry->tag, "PT", 2) == 0 &&
+           telemetry->version == PUMP_TELEMETRY_VERSION;
+}
+
+// One binary record from the pump driver's sysfs "telemetry" file
+int read_local_telemetry(struct pump_telemetry *telemetry) {
+    int fd = open(DEVICE_PATH_PUMP "telemetry", O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t bytes = read(fd, telemetry, sizeof(*telemetry));
+    close(fd);
+    return valid_telemetry(telemetry, bytes) ? 0 : -1;
+}
+
+// "pump_telemetry": the MCU echoes the command, then answers with one record
+int fetch_mcu_telemetry(NetLink *link, const struct sockaddr_in *server_addr, struct pump_telemetry *telemetry) {
+    const char *request = "pump_telemetry";
+    NetDatagram reply;
+
+    net_send(link, server_addr, request, strlen(request));
+    for (int i = 0; i < 2; i++) {
+        if (net_recv(link, &reply, REPLY_TIMEOUT_MS) <= 0) {
+            break;
+        }
+        if (valid_telemetry((const struct pump_telemetry *)reply.data, reply.len)) {
+            memcpy(telemetry, reply.data, sizeof(*telemetry));
+            return 0;
+        }
+    }
+    return -1;
+}
 
 
 
@@ -31,10 +248,7 @@ void delete_specific_files() {
     const char *files_to_delete[] = {
         "humidity_log.txt",
         "light_log.txt",
-        "saltiness_log.txt",
-        "received_data_1.txt",
-        "received_data_2.txt",
-        "received_data_3.txt"        
+        "saltiness_log.txt"
     };
 
     // Number of files to delete
@@ -54,54 +268,25 @@ void delete_specific_files() {
         }
     }
 }
-void read_device(Device *device) {
-    char value_path[256], changed_value_path[256];
-    snprintf(value_path, sizeof(value_path), "%svalue", device->device_path);
-    snprintf(changed_value_path, sizeof(changed_value_path), "%schanged_value", device->device_path);
-
-    FILE *value_file = fopen(value_path, "r");
-    if (!value_file) {
-        fprintf(stderr, "Error: Failed to open value file for %s\n", device->sensor_name);
-        return;
-    }
+void store_sample(Device *device, const Sample *sample) {
+    char value[8];
+    snprintf(value, sizeof(value), "%u\n", sample->value);
 
-    FILE *changed_value_file = fopen(changed_value_path, "r");
-    if (!changed_value_file) {
-        fprintf(stderr, "Error: Failed to open changed_value file for %s\n", device->sensor_name);
-        fclose(value_file);
-        return;
+    if (device->change_count == MAX_CHANGES) {
+        free(device->changes[0]);
+        memmove(device->changes, device->changes + 1, (MAX_CHANGES - 1) * sizeof(char *));
+        device->change_count--;
     }
+    device->changes[device->change_count] = strdup(value);
+    device->change_count++;
 
-    char value[256], changed_value[256];
-    fgets(value, sizeof(value), value_file);
-    fgets(changed_value, sizeof(changed_value), changed_value_file);
-
-    if (strcmp(changed_value, "1\n") == 0) {
-        if (device->change_count == MAX_CHANGES) {
-            free(device->changes[0]);
-            memmove(device->changes, device->changes + 1, (MAX_CHANGES - 1) * sizeof(char *));
-            device->change_count--;
-        }
-        device->changes[device->change_count] = strdup(value);
-        device->change_count++;
-
+    if (verbose) {
         // Print the new value with the sensor name
         printf("New value for %s: %s", device->sensor_name, value);
-
-        // Reset the changed_value to 0
-        fclose(changed_value_file);
-        changed_value_file = fopen(changed_value_path, "w");
-        if (!changed_value_file) {
-            fprintf(stderr, "Error: Failed to open changed_value file for writing for %s\n", device->sensor_name);
-        } else {
-            fputs("0", changed_value_file);
-            fclose(changed_value_file);
-        }
-    } else {
-        fclose(changed_value_file);
     }
-
-    fclose(value_file);
+    if (record_trace) {
+        trace_write(record_trace, sample);
+    }
 }
 
 void write_log(Device *device) {
@@ -119,13 +304,29 @@ void write_log(Device *device) {
 void *monitor_device(void *arg) {
     Device *device = (Device *)arg;
     time_t start_time = time(NULL);
+    Sample sample;
+
+    if (!device->source) {
+        device->source = source_sysfs_open(device->device_path, device->sensor);
+        if (!device->source) {
+            return NULL;
+        }
+    }
 
     // Monitor for a specified duration
     device->monitoring = 1; // Set monitoring flag
     while (device->monitoring && (time(NULL) - start_time < MONITOR_DURATION)) {
-        read_device(device);
-        write_log(device);
-        sleep(0.1);
+        int result = device->source->next(device->source, &sample);
+        if (result == SOURCE_END) {
+            break;
+        }
+        if (result == SOURCE_SAMPLE) {
+            // Close the control loop right here, storage happens on the writer thread
+            rules_eval(&rule_engine, &sample);
+            queue_push(&sample_queue, &sample);
+            comparator_push(&comparator, &sample);
+        }
+        // No sleep here: an idle sysfs or GPIO source has already waited for input in next()
     }
     
     // After monitoring ends, mark monitoring as stopped
@@ -133,82 +334,531 @@ void *monitor_device(void *arg) {
     return NULL;
 }
 
-float calculate_similarity(const char *file_path1, const char *file_path2) {
-    FILE *file1 = fopen(file_path1, "r");
-    FILE *file2 = fopen(file_path2, "r");
+// Drain the sample queue in batches and rewrite each touched log once per batch
+void *writer_thread(void *arg) {
+    Device *devices = (Device *)arg;
+    Sample batch[WRITER_BATCH];
+    struct timespec idle = {0, 1000000}; // 1 ms
+
+    for (;;) {
+        // Read the flag before draining so nothing pushed before the stop is left behind
+        int running = atomic_load(&writer_running);
+        size_t count = queue_pop_batch(&sample_queue, batch, WRITER_BATCH);
+        if (count == 0) {
+            if (!running) {
+                break;
+            }
+            nanosleep(&idle, NULL);
+            continue;
+        }
 
-    if (!file1) {
-        fprintf(stderr, "Error: Failed to open the first data file: %s\n", file_path1);
-        return 0.0;
+        int dirty[SENSOR_COUNT] = {0};
+        for (size_t i = 0; i < count; i++) {
+            store_sample(&devices[batch[i].sensor], &batch[i]);
+            dirty[batch[i].sensor] = 1;
+        }
+        for (int i = 0; i < SENSOR_COUNT; i++) {
+            if (dirty[i]) {
+                write_log(&devices[i]);
+            }
+        }
     }
-    
-    if (!file2) {
-        fprintf(stderr, "Error: Failed to open the second data file: %s\n", file_path2);
-        fclose(file1); // Close the first file before returning
-        return 0.0;
-    }
-
-    char line1[256];
-    char line2[256];
-    int matches = 0;
-    int total_lines_file1 = 0;
-    int total_lines_file2 = 0;
-
-    // Read each line from the first file and compare with lines from the second file
-    while (fgets(line1, sizeof(line1), file1)) {
-        total_lines_file1++;
-        // Compare with each line in the second file
-        fseek(file2, 0, SEEK_SET); // Reset file2 pointer to the beginning
-        while (fgets(line2, sizeof(line2), file2)) {
-            total_lines_file2++;
-            if (strcmp(line1, line2) == 0) {
-                matches++;
-                break; // Break after finding a match
+    return NULL;
+}
+
+static uint64_t elapsed_ns(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - start->tv_sec) * 1000000000ull + (now.tv_nsec - start->tv_nsec);
+}
+
+// Feed a recorded trace through store -> aggregate -> compare on this thread and report throughput
+int run_replay(Device *devices, int device_count, const char *trace_path, int realtime,
+               const FaultConfig *faults) {
+    FaultCounters fault_counters = {0};
+    ReplayStats stats[SENSOR_COUNT] = {0};
+    SensorSource *source = source_trace_open(trace_path, realtime);
+    if (!source) {
+        return EXIT_FAILURE;
+    }
+    SensorSource *faulty = source_fault_wrap(source, faults, &fault_counters);
+    if (!faulty) {
+        fprintf(stderr, "Error: Failed to set up fault injection\n");
+        source_close(source);
+        return EXIT_FAILURE;
+    }
+    source = faulty;
+
+    struct timespec start;
+    unsigned long total = 0;
+    Sample sample;
+    int result;
+
+    verbose = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while ((result = source->next(source, &sample)) != SOURCE_END) {
+        if (result != SOURCE_SAMPLE || sample.sensor >= device_count) {
+            continue;
+        }
+        rules_eval(&rule_engine, &sample);
+        store_sample(&devices[sample.sensor], &sample);
+
+        ReplayStats *stat = &stats[sample.sensor];
+        if (!stat->seen || sample.value < stat->min_value) stat->min_value = sample.value;
+        if (!stat->seen || sample.value > stat->max_value) stat->max_value = sample.value;
+        stat->value_sum += sample.value;
+        stat->samples++;
+
+        if (stat->seen && sample.seq + 1 == stat->next_seq) {
+            stat->duplicates++;
+        } else if (stat->seen && sample.seq < stat->next_seq) {
+            stat->reordered++;
+        } else {
+            if (stat->seen) {
+                stat->gaps += sample.seq - stat->next_seq;
             }
+            stat->next_seq = sample.seq + 1;
         }
+        stat->seen = 1;
+        total++;
     }
+    uint64_t elapsed = elapsed_ns(&start);
+    source_close(source);
 
-    fclose(file1);
-    fclose(file2);
+    for (int i = 0; i < device_count; i++) {
+        write_log(&devices[i]);
+        ReplayStats *stat = &stats[i];
+        printf("%s: %lu samples, %lu missing, %lu duplicate, %lu reordered, min %u max %u mean %.2f\n",
+               devices[i].sensor_name, stat->samples, stat->gaps, stat->duplicates, stat->reordered,
+               stat->min_value, stat->max_value, stat->samples ? (double)stat->value_sum / stat->samples : 0.0);
+    }
+    printf("Faults: %lu passed, %lu dropped, %lu duplicated, %lu delayed, %lu flipped, %lu stuck\n",
+           fault_counters.passed, fault_counters.dropped, fault_counters.duplicated,
+           fault_counters.delayed, fault_counters.flipped, fault_counters.stuck);
+    printf("Replayed %lu samples in %.3f ms, %.0f samples/s\n", total, elapsed / 1e6,
+           elapsed ? total * 1e9 / elapsed : 0.0);
+    return EXIT_SUCCESS;
+}
+
+// SPEC is "am335x" for the dts pins, or "/dev/gpiochipN:H,S,L" with one line offset per sensor
+int open_gpio_cdev(Device *devices, int device_count, const char *spec, unsigned slot_us) {
+    char chip_path[64];
+    unsigned offsets[SENSOR_COUNT];
 
-    // Calculate percentage based on the lines from file1
-    return (total_lines_file1 > 0) ? ((float)matches / total_lines_file1) * 100.0 : 0.0; // Calculate percentage
+    for (int i = 0; i < device_count; i++) {
+        if (strcmp(spec, "am335x") == 0) {
+            snprintf(chip_path, sizeof(chip_path), "/dev/gpiochip%d", devices[i].pin / GPIO_LINES_PER_CHIP);
+            offsets[i] = devices[i].pin % GPIO_LINES_PER_CHIP;
+        } else {
+            const char *colon = strrchr(spec, ':');
+            if (!colon || (size_t)(colon - spec) >= sizeof(chip_path) ||
+                sscanf(colon + 1, "%u,%u,%u", &offsets[0], &offsets[1], &offsets[2]) != SENSOR_COUNT) {
+                fprintf(stderr, "Error: Invalid GPIO spec %s\n", spec);
+                return -1;
+            }
+            snprintf(chip_path, sizeof(chip_path), "%.*s", (int)(colon - spec), spec);
+        }
+
+        devices[i].source = source_gpio_cdev_open(chip_path, offsets[i], devices[i].sensor, slot_us);
+        if (!devices[i].source) {
+            return -1;
+        }
+    }
+    return 0;
 }
 
-void save_received_data(const char *data, int index) {
-    char filename[20];
-    snprintf(filename, sizeof(filename), "received_data_%d.txt", index + 1); // Create filename for saving data
+// Next reply as a C string, cut to fit. Returns its length, -1 after REPLY_TIMEOUT_MS without one.
+static int recv_text(NetLink *link, char *text, size_t size) {
+    NetDatagram datagram;
+
+    if (net_recv(link, &datagram, REPLY_TIMEOUT_MS) <= 0) {
+        return -1;
+    }
+    size_t length = datagram.len < size - 1 ? datagram.len : size - 1;
+    memcpy(text, datagram.data, length);
+    text[length] = '\0';
+    return (int)length;
+}
 
-    FILE *file = fopen(filename, "a"); // Open in append mode
-    if (!file) {
-        fprintf(stderr, "Error: Failed to open file %s for writing\n", filename);
+static uint64_t monotonic_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+// One round of "sync" exchanges, the shortest round trip becomes a new point of mcu_clock.
+// t4 is the kernel's receive time, so time spent before recvmmsg() picks the reply up does not count.
+int sync_mcu_clock(NetLink *link, const struct sockaddr_in *server_addr) {
+    char request[64];
+    uint64_t best[4] = {0}, best_delay = UINT64_MAX;
+    NetDatagram datagram;
+
+    for (int i = 0; i < SYNC_EXCHANGES; i++) {
+        uint64_t t1 = monotonic_now_ns();
+        snprintf(request, sizeof(request), "sync %llu", (unsigned long long)t1);
+        net_send(link, server_addr, request, strlen(request));
+
+        while (net_recv(link, &datagram, REPLY_TIMEOUT_MS) > 0) {
+            const ClockSyncReply *reply = (const ClockSyncReply *)datagram.data;
+            uint64_t t4 = datagram.rx_ns;
+            // Skip the echo and anything left over from an earlier, timed out exchange
+            if (datagram.len != sizeof(*reply) || memcmp(reply->tag, "CS", 2) != 0 || reply->request_ns != t1 ||
+                reply->tx_us < reply->rx_us || t4 < t1) {
+                continue;
+            }
+            uint64_t delay = (t4 - t1) - (reply->tx_us - reply->rx_us) * 1000;
+            if (delay < best_delay) {
+                best_delay = delay;
+                best[0] = t1;
+                best[1] = reply->rx_us;
+                best[2] = reply->tx_us;
+                best[3] = t4;
+            }
+            break;
+        }
+    }
+
+    if (best_delay == UINT64_MAX) {
+        printf("Clock sync: no reply from the MCU.\n");
+        return -1;
+    }
+    clock_sync_add(&mcu_clock, best[0], best[1], best[2], best[3]);
+    printf("Clock sync: round trip %.1f us, drift %+.2f ppm over %d rounds\n",
+           mcu_clock.delay_ns / 1000.0, clock_sync_drift_ppm(&mcu_clock), mcu_clock.count);
+    return 0;
+}
+
+// Incremental sync: ask the MCU only for samples after the ones already fetched.
+// Fetched samples are stamped on CLOCK_MONOTONIC and appended to MCU_TRACE_FILE.
+void fetch_new_samples(NetLink *link, const struct sockaddr_in *server_addr, Device *devices, int device_count) {
+    char request[64];
+    NetDatagram datagram;
+    unsigned long fetched[SENSOR_COUNT] = {0};
+    uint32_t next_seq[SENSOR_COUNT] = {0};
+    uint64_t newest_ns[SENSOR_COUNT] = {0};
+    int behind = 1;
+
+    sync_mcu_clock(link, server_addr); // Every fetch adds a point, so the drift fit spans the session
+    // The link comparator joins on time, untimed samples would only count as lost or spurious.
+    // Nothing is fetched then, so the cursors stay put and the next fetch gets the same samples.
+    if (!mcu_clock.valid) {
+        printf("MCU clock not synced, fetch refused. Press 7 to sync first.\n");
         return;
     }
+    FILE *trace = fopen(MCU_TRACE_FILE, "a");
+    if (!trace) {
+        fprintf(stderr, "Warning: Failed to open %s: %s, fetched samples are not traced\n", MCU_TRACE_FILE,
+                strerror(errno));
+    }
+
+    for (int round = 0; round < FETCH_MAX_ROUNDS && behind; round++) {
+        snprintf(request, sizeof(request), "fetch %u %u %u", devices[0].remote_seq, devices[1].remote_seq,
+                 devices[2].remote_seq);
+        net_send(link, server_addr, request, strlen(request));
+
+        int done = 0, echoed = 0;
+        while (done < device_count) {
+            if (net_recv(link, &datagram, REPLY_TIMEOUT_MS) <= 0) {
+                printf("Fetch timed out.\n");
+                behind = 0;
+                break;
+            }
+            const SampleBatchHeader *header = (const SampleBatchHeader *)datagram.data;
+            if (!echoed && datagram.len == strlen(request) && memcmp(datagram.data, request, datagram.len) == 0) {
+                echoed = 1; // The MCU echoes every command first
+                continue;
+            }
+            if (datagram.len < sizeof(*header) || memcmp(header->tag, "ST", 2) != 0 ||
+                header->sensor >= device_count || sizeof(*header) + header->count * sizeof(SampleRecord) > datagram.len) {
+                continue;
+            }
+
+            Device *device = &devices[header->sensor];
+            if (header->first_seq > header->next_seq) {
+                // Asked for samples past the ring's end: it counts from 0 again (MCU reboot). Start over from
+                // the oldest sample it holds, the next round fetches them. Once per reply, older firmware
+                // sends several of these empty batches.
+                if (device->remote_seq > header->next_seq) {
+                    device->remote_seq = 0;
+                    device->remote_resets++;
+                }
+                next_seq[header->sensor] = header->next_seq;
+                done += header->last;
+                continue;
+            }
+            const SampleRecord *records = (const SampleRecord *)(datagram.data + sizeof(*header));
+            for (uint16_t i = 0; i < header->count; i++) {
+                Sample sample = {clock_sync_to_monotonic(&mcu_clock, records[i].tick_us), header->first_seq + i,
+                                 header->sensor, records[i].value, ORIGIN_MCU};
+                newest_ns[header->sensor] = sample.ts_ns;
+                comparator_push(&comparator, &sample);
+                if (trace) {
+                    trace_write(trace, &sample);
+                }
+            }
+            if (header->first_seq > device->remote_seq) {
+                device->remote_lost += header->first_seq - device->remote_seq;
+            }
+            if (header->first_seq + header->count > device->remote_seq) {
+                device->remote_seq = header->first_seq + header->count;
+            }
+            fetched[header->sensor] += header->count;
+            next_seq[header->sensor] = header->next_seq;
+            done += header->last;
+        }
+
+        behind = 0;
+        for (int i = 0; i < device_count; i++) {
+            behind |= devices[i].remote_seq < next_seq[i];
+        }
+    }
+    if (trace) {
+        fclose(trace);
+    }
+
+    for (int i = 0; i < device_count; i++) {
+        printf("%s: fetched %lu new samples, up to #%u, %lu lost on the MCU so far",
+               devices[i].sensor_name, fetched[i], devices[i].remote_seq, devices[i].remote_lost);
+        if (devices[i].remote_resets) {
+            printf(", its ring restarted %lu times", devices[i].remote_resets);
+        }
+        if (newest_ns[i]) {
+            char when[32];
+            uint64_t real_ns = monotonic_to_realtime(newest_ns[i]);
+            time_t seconds = (time_t)(real_ns / 1000000000ull);
+            strftime(when, sizeof(when), "%H:%M:%S", localtime(&seconds));
+            printf(", newest at %s.%06llu", when, (unsigned long long)(real_ns % 1000000000ull / 1000));
+        }
+        printf("\n");
+    }
+}
 
-	for (size_t i = 0; i < strlen(data); i++) {
-		fprintf(file, "%u\n", (uint8_t)data[i]); // Cast character to uint8_t and write
-	}
-    fclose(file);
+// "config ...": retime the MCU's frames, it echoes the command and then reports the values in effect
+void configure_mcu(NetLink *link, const struct sockaddr_in *server_addr, const char *settings) {
+    char request[MAX_CONFIG_LEN + 8];
+    char reply[128];
+
+    snprintf(request, sizeof(request), "config %s", settings);
+    net_send(link, server_addr, request, strlen(request));
+    for (int i = 0; i < 2; i++) {
+        if (recv_text(link, reply, sizeof(reply)) < 0) {
+            printf("No config reply from the MCU.\n");
+            break;
+        }
+        if (strncmp(reply, "config ok", 9) == 0 || strncmp(reply, "config rejected", 15) == 0) {
+            printf("%s", reply);
+            break;
+        }
+    }
 }
 
-int main() {
+static BoardSession *find_session(const struct sockaddr_in *addr) {
+    for (int i = 0; i < board_session_count; i++) {
+        if (board_sessions[i].addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+            board_sessions[i].addr.sin_port == addr->sin_port) {
+            return &board_sessions[i];
+        }
+    }
+    return NULL;
+}
+
+// Park the clock fit and fetch cursors of the current board, bring back the new board's if it was
+// used before. The comparator's windows and skew belong to the old link, it starts over.
+void switch_board(struct sockaddr_in *server_addr, const struct sockaddr_in *next, Device *devices, int device_count) {
+    BoardSession *session = find_session(server_addr);
+
+    if (server_addr->sin_addr.s_addr == next->sin_addr.s_addr && server_addr->sin_port == next->sin_port) {
+        return;
+    }
+    if (!session && board_session_count < BOARD_MAX) {
+        session = &board_sessions[board_session_count++];
+        session->addr = *server_addr;
+    }
+    if (session) {
+        session->clock = mcu_clock;
+        for (int i = 0; i < device_count; i++) {
+            session->remote_seq[devices[i].sensor] = devices[i].remote_seq;
+            session->remote_lost[devices[i].sensor] = devices[i].remote_lost;
+            session->remote_resets[devices[i].sensor] = devices[i].remote_resets;
+        }
+    }
+
+    session = find_session(next);
+    if (session) {
+        mcu_clock = session->clock;
+    } else {
+        clock_sync_init(&mcu_clock);
+    }
+    for (int i = 0; i < device_count; i++) {
+        devices[i].remote_seq = session ? session->remote_seq[devices[i].sensor] : 0;
+        devices[i].remote_lost = session ? session->remote_lost[devices[i].sensor] : 0;
+        devices[i].remote_resets = session ? session->remote_resets[devices[i].sensor] : 0;
+    }
+    if (comparator_reset(&comparator) < 0) {
+        fprintf(stderr, "Error: Failed to restart the link comparator\n");
+    }
+    *server_addr = *next;
+}
+
+void print_link_report(const Device *devices, int device_count) {
+    for (int i = 0; i < device_count; i++) {
+        JoinStats *stats = &comparator.stats[devices[i].sensor];
+        unsigned long matched = atomic_load(&stats->matched);
+        unsigned long corrupt = atomic_load(&stats->corrupt);
+        unsigned long lost = atomic_load(&stats->lost);
+        unsigned long spurious = atomic_load(&stats->spurious);
+        unsigned long judged = matched + lost + spurious;
+
+        printf("%s: %lu GPIO / %lu MCU samples, match rate %.2f%% (%lu matched, %lu corrupt, %lu lost, "
+               "%lu spurious), %lu unobserved, %lu evicted, %lu seq slips",
+               devices[i].sensor_name, atomic_load(&stats->gpio), atomic_load(&stats->mcu),
+               judged ? 100.0 * (matched - corrupt) / judged : 0.0, matched, corrupt, lost, spurious,
+               atomic_load(&stats->unobserved), atomic_load(&stats->evicted), atomic_load(&stats->seq_slips));
+        if (matched) {
+            printf(", skew %.3f ms (%.3f .. %.3f)", atomic_load(&stats->skew_sum_ns) / 1e6 / matched,
+                   atomic_load(&stats->skew_min_ns) / 1e6, atomic_load(&stats->skew_max_ns) / 1e6);
+        }
+        printf("\n");
+    }
+}
+
+void usage(const char *program) {
+    printf("Usage: %s [--record FILE] [--queue-size N] [--queue-policy drop-oldest|block]\n"
+           "          [--gpio-cdev am335x|/dev/gpiochipN:H,S,L] [--frame-slot-us US] [--compare-workers N]\n"
+           "          [--rcvbuf BYTES] [--busy-poll US] [--mcu ADDR] [--group ADDR] [--mcast-if ADDR]\n"
+           "          [--probe-ms MS]\n"
+           "       %s --replay FILE [--fast] [--drop P] [--dup P] [--delay P] [--delay-ms MS]\n"
+           "          [--flip P] [--stuck P] [--seed N]\n", program, program);
+}
+
+int main(int argc, char **argv) {
     Device devices[] = {
-        {DEVICE_PATH_HUMIDITY, "humidity_log.txt", "Humidity", {0}, 0, 0},
-        {DEVICE_PATH_SALTINESS, "saltiness_log.txt", "Saltiness", {0}, 0, 0},
-        {DEVICE_PATH_LIGHT, "light_log.txt", "Light", {0}, 0, 0}
+        {DEVICE_PATH_HUMIDITY, "humidity_log.txt", "Humidity", {0}, 0, 0, SENSOR_HUMIDITY, NULL, 67},
+        {DEVICE_PATH_SALTINESS, "saltiness_log.txt", "Saltiness", {0}, 0, 0, SENSOR_SALTINESS, NULL, 68},
+        {DEVICE_PATH_LIGHT, "light_log.txt", "Light", {0}, 0, 0, SENSOR_LIGHT, NULL, 44}
     };
 
     int device_count = sizeof(devices) / sizeof(devices[0]);
     pthread_t threads[device_count];
 
+    static const struct option options[] = {
+        {"replay", required_argument, NULL, 'r'},
+        {"fast", no_argument, NULL, 'f'},
+        {"record", required_argument, NULL, 'w'},
+        {"drop", required_argument, NULL, 'd'},
+        {"dup", required_argument, NULL, 'u'},
+        {"delay", required_argument, NULL, 'l'},
+        {"delay-ms", required_argument, NULL, 'm'},
+        {"flip", required_argument, NULL, 'b'},
+        {"stuck", required_argument, NULL, 's'},
+        {"seed", required_argument, NULL, 'e'},
+        {"queue-size", required_argument, NULL, 'q'},
+        {"queue-policy", required_argument, NULL, 'p'},
+        {"gpio-cdev", required_argument, NULL, 'g'},
+        {"frame-slot-us", required_argument, NULL, 't'},
+        {"compare-workers", required_argument, NULL, 'c'},
+        {"rcvbuf", required_argument, NULL, 'n'},
+        {"busy-poll", required_argument, NULL, 'y'},
+        {"mcu", required_argument, NULL, 'a'},
+        {"group", required_argument, NULL, 'o'},
+        {"mcast-if", required_argument, NULL, 'i'},
+        {"probe-ms", required_argument, NULL, 'k'},
+        {NULL, 0, NULL, 0}
+    };
+    FaultConfig faults = {0};
+    const char *replay_path = NULL;
+    const char *record_path = NULL;
+    const char *gpio_spec = NULL;
+    unsigned frame_slot_us = FRAME_SLOT_US;
+    int realtime = 1;
+    size_t queue_capacity = QUEUE_CAPACITY;
+    int compare_workers = COMPARE_WORKERS;
+    NetConfig net_config = {NET_RCVBUF, 0};
+    const char *mcu_ip = UDP_SERVER_IP;
+    const char *group = DISCOVERY_GROUP;
+    struct in_addr mcast_if = {htonl(INADDR_ANY)};
+    int probe_ms = BOARD_PROBE_MS;
+    int have_boards;
+    QueuePolicy queue_policy = QUEUE_DROP_OLDEST;
+    int option;
+
+    faults.delay_ms = 100;
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (option) {
+        case 'r': replay_path = optarg; break;
+        case 'f': realtime = 0; break;
+        case 'w': record_path = optarg; break;
+        case 'd': faults.drop = atof(optarg); break;
+        case 'u': faults.duplicate = atof(optarg); break;
+        case 'l': faults.delay = atof(optarg); break;
+        case 'm': faults.delay_ms = (unsigned)atoi(optarg); break;
+        case 'b': faults.bit_flip = atof(optarg); break;
+        case 's': faults.stuck = atof(optarg); break;
+        case 'e': faults.seed = (unsigned)atoi(optarg); break;
+        case 'q': queue_capacity = (size_t)atol(optarg); break;
+        case 'g': gpio_spec = optarg; break;
+        case 't': frame_slot_us = (unsigned)atoi(optarg); break;
+        case 'c': compare_workers = atoi(optarg); break;
+        case 'n': net_config.rcvbuf = atoi(optarg); break;
+        case 'y': net_config.busy_poll_us = atoi(optarg); break;
+        case 'a': mcu_ip = optarg; break;
+        case 'o': group = optarg; break;
+        case 'i':
+            if (inet_pton(AF_INET, optarg, &mcast_if) != 1) {
+                fprintf(stderr, "Error: Bad interface address %s\n", optarg);
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'k': probe_ms = atoi(optarg); break;
+        case 'p':
+            if (strcmp(optarg, "block") == 0) {
+                queue_policy = QUEUE_BLOCK;
+            } else if (strcmp(optarg, "drop-oldest") == 0) {
+                queue_policy = QUEUE_DROP_OLDEST;
+            } else {
+                fprintf(stderr, "Error: Unknown queue policy %s\n", optarg);
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (replay_path) {
+        load_rules();
+        int status = run_replay(devices, device_count, replay_path, realtime, &faults);
+        close(alert_sockfd);
+        return status;
+    }
+    if (gpio_spec && open_gpio_cdev(devices, device_count, gpio_spec, frame_slot_us) < 0) {
+        return EXIT_FAILURE;
+    }
+    if (queue_init(&sample_queue, queue_capacity, queue_policy) < 0) {
+        fprintf(stderr, "Error: Failed to allocate the sample queue\n");
+        return EXIT_FAILURE;
+    }
+    if (comparator_start(&comparator, compare_workers, COMPARE_TOLERANCE_MS * 1000000ull,
+                         COMPARE_MAX_LATENCY_MS * 1000000ull, queue_capacity) < 0) {
+        fprintf(stderr, "Error: Failed to start the link comparator\n");
+        return EXIT_FAILURE;
+    }
+    if (record_path) {
+        record_trace = fopen(record_path, "a");
+        if (!record_trace) {
+            fprintf(stderr, "Error: Failed to open trace %s: %s\n", record_path, strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+
     // Create UDP socket
-    int sockfd;
-    struct sockaddr_in server_addr, from_addr;
-    socklen_t addr_len = sizeof(from_addr);
+    struct sockaddr_in server_addr;
     char buffer[256]; // Increased buffer size for incoming data
 
-    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sockfd < 0) {
+    if (net_open(&mcu_link, &net_config) < 0) {
         perror("Socket creation failed");
         return EXIT_FAILURE;
     }
@@ -216,10 +866,22 @@ int main() {
     memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
     server_addr.sin_port = htons(UDP_SERVER_PORT);
-    inet_pton(AF_INET, UDP_SERVER_IP, &server_addr.sin_addr);
+    if (inet_pton(AF_INET, mcu_ip, &server_addr.sin_addr) != 1) {
+        fprintf(stderr, "Error: Bad MCU address %s\n", mcu_ip);
+        return EXIT_FAILURE;
+    }
+    // Without discovery the gateway still talks to the one MCU it was given
+    have_boards = board_table_open(&board_table, &net_config, group, mcast_if, probe_ms) == 0;
+    if (!have_boards) {
+        fprintf(stderr, "Warning: Board discovery is off\n");
+    }
+
+    clock_sync_init(&mcu_clock);
+    pump_open(); // Without the pump module the gateway still monitors, it just can't actuate
+    load_rules();
 
     while (1) {
-        printf("- press 1 to send a UDP message and start monitoring for 10 seconds,\n\r- press 2 to compare received data,\n\r- press 3 to PUMP state\n\r- press any other key to exit...\n\r");
+        printf("- press 1 to send a UDP message and start monitoring for 10 seconds,\n\r- press 2 to fetch from the MCU and check the GPIO link,\n\r- press 3 to PUMP state\n\r- press 4 for local pump state and ON-time counters\n\r- press 5 to fetch new samples from the MCU\n\r- press 6 for pump duty-cycle telemetry from the MCU and the local driver\n\r- press 7 to sync the MCU clock\n\r- press 8 to set MCU timing (debounce <ms> bit <ms> dma_tick_us <us>)\n\r- press 9 for UDP batching and drop counters\n\r- press a to start every board with one multicast datagram\n\r- press b to list the discovered boards and pick the one to talk to\n\r- press any other key to exit...\n\r");
         int input = getchar(); // Get user input
         getchar(); // Consume the newline character
 
@@ -227,26 +889,33 @@ int main() {
 			delete_specific_files();
             // Send UDP message
             const char *message = "1"; // Message to send
-            sendto(sockfd, message, strlen(message), 0, (const struct sockaddr *)&server_addr, sizeof(server_addr));
+            net_send(&mcu_link, &server_addr, message, strlen(message));
 
             // Receive response immediately
-            int bytes_received = recvfrom(sockfd, buffer, sizeof(buffer) - 1, 0, (struct sockaddr *)&from_addr, &addr_len);
+            int bytes_received = recv_text(&mcu_link, buffer, sizeof(buffer));
             if (bytes_received > 0) {
-                buffer[bytes_received] = '\0'; // Null-terminate the received string
                 printf("Received response: %s\n", buffer); // Print the response
 
                 if (strcmp(buffer, "1") == 0) {
                     // Start monitoring if the response is "1"
+                    pthread_t writer;
+                    queue_reset_counters(&sample_queue); // The counts below are this run's only
+                    atomic_store(&writer_running, 1);
+                    pthread_create(&writer, NULL, writer_thread, devices);
                     for (int i = 0; i < device_count; i++) {
                         pthread_create(&threads[i], NULL, monitor_device, &devices[i]);
                     }
 
-                    // Wait for all threads to finish monitoring
+                    // Wait for all threads to finish monitoring, then let the writer drain
                     for (int i = 0; i < device_count; i++) {
                         pthread_join(threads[i], NULL);
                     }
+                    atomic_store(&writer_running, 0);
+                    pthread_join(writer, NULL);
 
-                    printf("Monitoring complete. Logs updated.\n");
+                    printf("Monitoring complete. Logs updated. Queue: %lu samples, %lu dropped, %lu blocked pushes\n",
+                           atomic_load(&sample_queue.pushed), atomic_load(&sample_queue.dropped),
+                           atomic_load(&sample_queue.blocked));
                 } else {
                     printf("Received unexpected response: %s\n", buffer);
                 }
@@ -254,51 +923,84 @@ int main() {
                 printf("Failed to receive response.\n");
             }
         } else if (input == '2') {
-    // Send UDP request to receive data
-    const char *request_message = "request_data"; // Message to send for data
-    sendto(sockfd, request_message, strlen(request_message), 0, (const struct sockaddr *)&server_addr, sizeof(server_addr));
-    int bytes_received = recvfrom(sockfd, buffer, sizeof(buffer) - 1, 0, (struct sockaddr *)&from_addr, &addr_len);
-    if (bytes_received > 0) {
-        buffer[bytes_received] = '\0'; // Null-terminate the received string
-        printf("Received response: %s\n", buffer); // Print the response
-    }
-
-    // Receive incoming data and save to three files
-    int received_count = 0;
-
-    while (received_count < 3) {
-        int bytes_received = recvfrom(sockfd, buffer, sizeof(buffer) - 1, 0, (struct sockaddr *)&from_addr, &addr_len);
-        if (bytes_received > 0) {
-            buffer[bytes_received] = '\0'; // Null-terminate the received string
-            save_received_data(buffer, received_count); // Save received data to file
-            received_count++;
-        } else {
-            printf("Failed to receive data.\n");
-        }
-    }
-
-    // Calculate and output the similarity percentage for each log file
-    for (int i = 0; i < 3; i++) {
-		char file_path[50];
-		sprintf(file_path, "received_data_%d.txt", i + 1); 
-        float similarity = calculate_similarity(file_path, devices[i].log_file);
-        printf("Similarity percentage for %s: %.2f%%\n", devices[i].log_file, similarity);
-    }
-} 
-else if (input == '3') {
+            // Joined against what the GPIO path decoded, as it streams in
+            fetch_new_samples(&mcu_link, &server_addr, devices, device_count);
+            comparator_wait_idle(&comparator);
+            print_link_report(devices, device_count);
+        } else if (input == '3') {
             // Send '3' and receive the same value back twice
             const char *message = "3"; // Message to send
-            sendto(sockfd, message, strlen(message), 0, (const struct sockaddr *)&server_addr, sizeof(server_addr));
+            net_send(&mcu_link, &server_addr, message, strlen(message));
 
             for (int i = 0; i < 2; i++) { // Receive the response twice
-                int bytes_received = recvfrom(sockfd, buffer, sizeof(buffer) - 1, 0, (struct sockaddr *)&from_addr, &addr_len);
+                int bytes_received = recv_text(&mcu_link, buffer, sizeof(buffer));
                 if (bytes_received > 0) {
-                    buffer[bytes_received] = '\0'; // Null-terminate the received string
                     printf("%s\n", buffer); // Print the received value
                 } else {
                     printf("Failed to receive response for '3'.\n");
                 }
             }
+        } else if (input == '4') {
+            print_pump_stats();
+        } else if (input == '5') {
+            fetch_new_samples(&mcu_link, &server_addr, devices, device_count);
+        } else if (input == '6') {
+            struct pump_telemetry telemetry;
+            if (fetch_mcu_telemetry(&mcu_link, &server_addr, &telemetry) == 0) {
+                print_pump_telemetry("MCU", &telemetry);
+            } else {
+                printf("No pump telemetry from the MCU.\n");
+            }
+            if (read_local_telemetry(&telemetry) == 0) {
+                print_pump_telemetry("Local", &telemetry);
+            } else {
+                fprintf(stderr, "Error: Failed to read %stelemetry\n", DEVICE_PATH_PUMP);
+            }
+        } else if (input == '7') {
+            sync_mcu_clock(&mcu_link, &server_addr);
+        } else if (input == '8') {
+            char settings[MAX_CONFIG_LEN];
+            printf("config> ");
+            if (fgets(settings, sizeof(settings), stdin)) {
+                settings[strcspn(settings, "\r\n")] = '\0';
+                configure_mcu(&mcu_link, &server_addr, settings);
+            }
+        } else if (input == '9') {
+            net_print_stats(&mcu_link);
+            if (have_boards) {
+                printf("Discovery socket:\n");
+                net_print_stats(&board_table.link);
+            }
+        } else if ((input == 'a' || input == 'b') && !have_boards) {
+            printf("Board discovery is off.\n");
+        } else if (input == 'a') {
+            Board boards[BOARD_MAX];
+            int known = board_table_snapshot(&board_table, boards, BOARD_MAX);
+            if (board_table_start_all(&board_table) < 0) {
+                printf("Failed to send start to %s\n", group);
+            } else {
+                // The acknowledgements are collected in the background, this only waits for the known boards
+                int acked = board_table_wait_start(&board_table, known, REPLY_TIMEOUT_MS);
+                printf("%d of %d known boards acknowledged start\n", acked, known);
+                board_table_print(&board_table);
+            }
+        } else if (input == 'b') {
+            Board boards[BOARD_MAX];
+            char choice[16];
+            board_table_probe(&board_table);
+            board_table_wait_probe(&board_table, BOARD_MAX, DISCOVERY_WAIT_MS);
+            board_table_print(&board_table);
+            int count = board_table_snapshot(&board_table, boards, BOARD_MAX);
+            printf("board (enter keeps the current one)> ");
+            if (fgets(choice, sizeof(choice), stdin) && choice[0] != '\n') {
+                int index = atoi(choice);
+                if (index >= 0 && index < count) {
+                    switch_board(&server_addr, &boards[index].addr, devices, device_count);
+                    printf("Talking to board %d\n", index);
+                } else {
+                    printf("No board %d\n", index);
+                }
+            }
         }
      else {
             printf("Exiting...\n");
@@ -306,6 +1008,21 @@ else if (input == '3') {
         }
     }
 
-    close(sockfd); // Close the socket
+    net_close(&mcu_link); // Close the socket
+    if (have_boards) {
+        board_table_close(&board_table);
+    }
+    if (pump_state_fd >= 0) {
+        close(pump_state_fd);
+    }
+    close(alert_sockfd);
+    for (int i = 0; i < device_count; i++) {
+        source_close(devices[i].source);
+    }
+    if (record_trace) {
+        fclose(record_trace);
+    }
+    comparator_stop(&comparator);
+    queue_destroy(&sample_queue);
     return 0;
 }
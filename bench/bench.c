@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "bench.h"
+
+static FILE *results = NULL; // Real stdout once bench_quiet() has redirected stdout
+
+uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+int bench_init(BenchRun *run, const char *name, size_t capacity, unsigned ops_per_sample) {
+    memset(run, 0, sizeof(*run));
+    run->name = name;
+    run->capacity = capacity;
+    run->ops_per_sample = ops_per_sample ? ops_per_sample : 1;
+    run->latency_ns = malloc(capacity * sizeof(uint64_t));
+    return run->latency_ns ? 0 : -1;
+}
+
+void bench_start(BenchRun *run) {
+    run->samples = 0;
+    run->start_ns = bench_now_ns();
+}
+
+void bench_sample(BenchRun *run, uint64_t elapsed_ns) {
+    if (run->samples < run->capacity) {
+        run->latency_ns[run->samples++] = elapsed_ns / run->ops_per_sample;
+    }
+}
+
+void bench_stop(BenchRun *run, uint64_t ops) {
+    run->elapsed_ns = bench_now_ns() - run->start_ns;
+    run->ops = ops;
+}
+
+double bench_ops_per_s(const BenchRun *run) {
+    return run->elapsed_ns ? run->ops * 1e9 / (double)run->elapsed_ns : 0.0;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Nearest rank on the sorted samples
+static uint64_t percentile(const BenchRun *run, double p) {
+    if (run->samples == 0) {
+        return 0;
+    }
+    size_t rank = (size_t)(p * run->samples + 0.999999);
+    return run->latency_ns[rank ? rank - 1 : 0];
+}
+
+void bench_report(BenchRun *run, const char *extra) {
+    FILE *out = results ? results : stdout;
+
+    qsort(run->latency_ns, run->samples, sizeof(uint64_t), compare_u64);
+    fprintf(out, "{\"bench\":\"%s\",\"ops\":%llu,\"ops_per_s\":%.0f,\"p50_ns\":%llu,\"p99_ns\":%llu,"
+            "\"p999_ns\":%llu,\"max_ns\":%llu,\"ops_per_sample\":%u%s%s}\n",
+            run->name, (unsigned long long)run->ops, bench_ops_per_s(run),
+            (unsigned long long)percentile(run, 0.50), (unsigned long long)percentile(run, 0.99),
+            (unsigned long long)percentile(run, 0.999), (unsigned long long)percentile(run, 1.0),
+            run->ops_per_sample, extra ? "," : "", extra ? extra : "");
+    fflush(out);
+}
+
+void bench_free(BenchRun *run) {
+    free(run->latency_ns);
+    run->latency_ns = NULL;
+}
+
+void bench_quiet(void) {
+    int fd = dup(STDOUT_FILENO);
+    results = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (results && !freopen("/dev/null", "w", stdout)) {
+        fclose(results);
+        results = NULL;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Common timing and reporting for the bench programs. Every case prints one
+ * JSON line:
+ *
+ *   {"bench":"<name>","ops":N,"ops_per_s":R,"p50_ns":..,"p99_ns":..,"p999_ns":..,
+ *    "max_ns":..,"ops_per_sample":B[,<case specific fields>]}
+ *
+ * Latencies are per operation. Cases far below the clock's resolution time
+ * a batch of ops_per_sample operations and record the batch mean, so the
+ * percentiles describe batches of that size rather than single operations.
+ */
+
+typedef struct {
+    const char *name;
+    uint64_t *latency_ns;   // Per-op latency of each sample
+    size_t samples;
+    size_t capacity;
+    unsigned ops_per_sample;
+    uint64_t ops;
+    uint64_t start_ns;
+    uint64_t elapsed_ns;
+} BenchRun;
+
+uint64_t bench_now_ns(void);
+int bench_init(BenchRun *run, const char *name, size_t capacity, unsigned ops_per_sample);
+void bench_start(BenchRun *run);
+void bench_sample(BenchRun *run, uint64_t elapsed_ns); // One timed sample of ops_per_sample operations
+void bench_stop(BenchRun *run, uint64_t ops);
+double bench_ops_per_s(const BenchRun *run);
+// Print the JSON line, extra is either NULL or more "key":value pairs without the leading comma
+void bench_report(BenchRun *run, const char *extra);
+void bench_free(BenchRun *run);
+
+// Send whatever the code under test prints to /dev/null, results keep going to the real stdout
+void bench_quiet(void);
+
+#endif /* BENCH_H */
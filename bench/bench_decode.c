@@ -0,0 +1,144 @@
+// Frame decode: the sensor modules' work_handler() loop and the gateway's edge decoder, on simulated lines
+// Build: make -C bench
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "../frame_decode.h"
+#include "../gpio_cdev.h"
+
+#define FRAME_COUNT 1000000
+#define BATCH 1000          // Frames per latency sample
+#define SLOT_NS 50000000ull // 50 ms slots, as on the board
+
+// A line that plays values[] back, one bit per read, LSB first like the MCU sends them
+typedef struct {
+    const uint8_t *values;
+    size_t frame;
+    int bit;
+} SimLine;
+
+static int sim_read(void *ctx) {
+    SimLine *line = ctx;
+    return (line->values[line->frame] >> line->bit) & 1;
+}
+
+// The kernel sleeps one slot here, the simulated line just moves on to the next bit
+static void sim_wait(void *ctx, unsigned int slot_ms) {
+    SimLine *line = ctx;
+    (void)slot_ms;
+    if (++line->bit == FRAME_DECODE_BITS) {
+        line->bit = 0;
+        line->frame++;
+    }
+}
+
+static int bench_work_handler(const uint8_t *values) {
+    SimLine line = {values, 0, 0};
+    unsigned long errors = 0;
+    volatile uint8_t sink;
+    BenchRun run;
+    char extra[64];
+
+    if (bench_init(&run, "decode_work_handler", FRAME_COUNT / BATCH, BATCH) < 0) {
+        return -1;
+    }
+    bench_start(&run);
+    for (size_t i = 0; i < FRAME_COUNT; i += BATCH) {
+        uint64_t start = bench_now_ns();
+        for (size_t j = i; j < i + BATCH; j++) {
+            uint8_t value = frame_decode(sim_read, sim_wait, &line, 50);
+            errors += value != values[j];
+            sink = value;
+        }
+        bench_sample(&run, bench_now_ns() - start);
+    }
+    bench_stop(&run, FRAME_COUNT);
+    (void)sink;
+
+    snprintf(extra, sizeof(extra), "\"errors\":%lu", errors);
+    bench_report(&run, extra);
+    bench_free(&run);
+    return errors ? -1 : 0;
+}
+
+// Edges of one frame as the GPIO character device reports them: start edge, then a change per bit
+static int frame_edges(uint8_t value, uint64_t start_ns, uint64_t ts[], int rising[]) {
+    int count = 0, level = 0;
+
+    ts[count] = start_ns;
+    rising[count++] = 0;
+    for (int bit = 0; bit < FRAME_DECODE_BITS; bit++) {
+        int next = (value >> bit) & 1;
+        if (next != level) {
+            ts[count] = start_ns + bit * SLOT_NS;
+            rising[count++] = next;
+            level = next;
+        }
+    }
+    if (!level) {
+        ts[count] = start_ns + FRAME_DECODE_BITS * SLOT_NS;
+        rising[count++] = 1; // Back to idle high
+    }
+    return count;
+}
+
+static int bench_cdev_edges(const uint8_t *values) {
+    FrameDecoder decoder;
+    unsigned long errors = 0, frames = 0;
+    uint64_t ts[FRAME_DECODE_BITS + 2];
+    int rising[FRAME_DECODE_BITS + 2];
+    uint8_t value;
+    uint64_t start_ns;
+    BenchRun run;
+    char extra[64];
+
+    if (bench_init(&run, "decode_cdev_edges", FRAME_COUNT / BATCH, BATCH) < 0) {
+        return -1;
+    }
+    frame_decoder_init(&decoder, SLOT_NS, 1);
+    bench_start(&run);
+    for (size_t i = 0; i < FRAME_COUNT; i += BATCH) {
+        uint64_t start = bench_now_ns();
+        for (size_t j = i; j < i + BATCH; j++) {
+            uint64_t frame_ns = (j + 1) * (FRAME_DECODE_BITS + 2) * SLOT_NS;
+            int count = frame_edges(values[j], frame_ns, ts, rising);
+            for (int e = 0; e < count; e++) {
+                if (frame_decoder_edge(&decoder, ts[e], rising[e], &value, &start_ns)) {
+                    errors += value != values[frames++];
+                }
+            }
+            // Nothing follows the last frame, the idle poll completes it
+            if (j + 1 == FRAME_COUNT && frame_decoder_flush(&decoder, frame_ns + 2 * FRAME_DECODE_BITS * SLOT_NS,
+                                                            &value, &start_ns)) {
+                errors += value != values[frames++];
+            }
+        }
+        bench_sample(&run, bench_now_ns() - start);
+    }
+    bench_stop(&run, FRAME_COUNT);
+
+    errors += FRAME_COUNT - frames;
+    snprintf(extra, sizeof(extra), "\"errors\":%lu", errors);
+    bench_report(&run, extra);
+    bench_free(&run);
+    return errors ? -1 : 0;
+}
+
+int main(void) {
+    uint8_t *values = malloc(FRAME_COUNT);
+    int status = 0;
+
+    if (!values) {
+        fprintf(stderr, "Error: bench setup failed\n");
+        return EXIT_FAILURE;
+    }
+    srand(1);
+    for (size_t i = 0; i < FRAME_COUNT; i++) {
+        values[i] = (uint8_t)(rand() % 16);
+    }
+
+    status |= bench_work_handler(values);
+    status |= bench_cdev_edges(values);
+    free(values);
+    return status ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,403 @@
+// Gateway <-> firmware over loopback: RTG.c and server.c run on the host stub in a thread,
+// the gateway side is UDP.c's own request code. Discovery and "start" fan-out add simulated
+// boards on loopback multicast next to it.
+// Build: make -C bench
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "bench.h"
+#include "../gateway.h"
+#include "../board_table.h"
+#include "frame_tx.h"
+#include "sample_ring.h"
+
+#define MCU_PORT 50007      // SERVER_PORT in RTG.h
+#define ROUND_TRIPS 10000
+#define SYNC_ROUNDS 200
+#define FETCH_ROUNDS 50
+#define FETCH_SAMPLES 2048  // Per sensor and fetch, well within the MCU's rings
+#define RESTART_ROUNDS 10   // Fetches in the ring restart case, the MCU reboots halfway through
+#define FAN_OUT_BOARDS 8    // The firmware plus simulated boards
+#define FAN_OUT_ROUNDS 500
+
+// RTG.h pulls in the HAL stand-ins and its own copies of the wire structs, so only these are declared here
+void rtg_init(void);
+void rtg_poll(void);
+extern SampleRing sample_rings[FRAME_TX_CHANNELS];
+
+static atomic_int firmware_running;
+
+static void *firmware_thread(void *arg) {
+    (void)arg;
+    while (atomic_load(&firmware_running)) {
+        rtg_poll();
+    }
+    return NULL;
+}
+
+// Boards that only know "discover" and "start". The group socket is bound to the group
+// address, so unicast to the firmware's port never reaches it. Replies leave from a socket
+// of their own, which also takes unicast commands; the table tells boards apart by it.
+typedef struct {
+    int rx_fd;
+    int tx_fd;
+    BoardAnnounce announce;
+} SimBoard;
+
+static SimBoard sim_boards[FAN_OUT_BOARDS - 1];
+static int sim_board_count;
+static atomic_int sim_running;
+
+static int sim_board_open(SimBoard *board, int index) {
+    struct sockaddr_in addr = {0};
+    struct ip_mreq request;
+    int reuse = 1;
+
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(MCU_PORT);
+    inet_pton(AF_INET, DISCOVERY_GROUP, &addr.sin_addr);
+    request.imr_multiaddr = addr.sin_addr;
+    request.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+    board->rx_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    board->tx_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (board->rx_fd < 0 || board->tx_fd < 0 ||
+        setsockopt(board->rx_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0 ||
+        bind(board->rx_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        setsockopt(board->rx_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) < 0) {
+        perror("Simulated board setup failed");
+        return -1;
+    }
+
+    memset(&board->announce, 0, sizeof(board->announce));
+    memcpy(board->announce.tag, "DB", 2);
+    board->announce.version = BOARD_ANNOUNCE_VERSION;
+    board->announce.sensors = SENSOR_COUNT;
+    board->announce.uid[0] = (uint32_t)index + 1;
+    board->announce.capabilities = BOARD_CAP_FETCH | BOARD_CAP_SYNC;
+    return 0;
+}
+
+static void *sim_board_thread(void *arg) {
+    struct pollfd pfd[2 * (FAN_OUT_BOARDS - 1)];
+    (void)arg;
+
+    for (int i = 0; i < sim_board_count; i++) {
+        pfd[2 * i] = (struct pollfd){sim_boards[i].rx_fd, POLLIN, 0};
+        pfd[2 * i + 1] = (struct pollfd){sim_boards[i].tx_fd, POLLIN, 0};
+    }
+    while (atomic_load(&sim_running)) {
+        if (poll(pfd, 2 * sim_board_count, 10) <= 0) {
+            continue;
+        }
+        for (int i = 0; i < 2 * sim_board_count; i++) {
+            SimBoard *board = &sim_boards[i / 2];
+            struct sockaddr_in from;
+            socklen_t from_len = sizeof(from);
+            char command[64];
+
+            if (!(pfd[i].revents & POLLIN)) {
+                continue;
+            }
+            ssize_t len = recvfrom(pfd[i].fd, command, sizeof(command), 0, (struct sockaddr *)&from, &from_len);
+            if (len <= 0) {
+                continue;
+            }
+            // Echo first, like the firmware
+            sendto(board->tx_fd, command, len, 0, (struct sockaddr *)&from, sizeof(from));
+            if (len == 8 && memcmp(command, "discover", 8) == 0) {
+                sendto(board->tx_fd, &board->announce, sizeof(BoardAnnounce), 0, (struct sockaddr *)&from, sizeof(from));
+            }
+        }
+    }
+    return NULL;
+}
+
+// One multicast datagram, then the wait until every board's reply is in the table.
+// Latency is per round, for all FAN_OUT_BOARDS boards together.
+static int bench_fan_out(BoardTable *table, const char *name, int start) {
+    unsigned long missed = 0;
+    BenchRun run;
+    char extra[64];
+
+    if (bench_init(&run, name, FAN_OUT_ROUNDS, 1) < 0) {
+        return -1;
+    }
+    bench_start(&run);
+    for (int i = 0; i < FAN_OUT_ROUNDS; i++) {
+        uint64_t begin = bench_now_ns();
+        int replies = start ? (board_table_start_all(table), board_table_wait_start(table, FAN_OUT_BOARDS, 1000))
+                            : (board_table_probe(table), board_table_wait_probe(table, FAN_OUT_BOARDS, 1000));
+        bench_sample(&run, bench_now_ns() - begin);
+        missed += FAN_OUT_BOARDS - replies;
+    }
+    bench_stop(&run, FAN_OUT_ROUNDS);
+
+    snprintf(extra, sizeof(extra), "\"boards\":%d,\"missed\":%lu", FAN_OUT_BOARDS, missed);
+    bench_report(&run, extra);
+    bench_free(&run);
+    return missed ? -1 : 0;
+}
+
+// The same start, one unicast exchange per board in turn, as without the group
+static int bench_start_unicast(NetLink *link, BoardTable *table) {
+    Board boards[BOARD_MAX];
+    int count = board_table_snapshot(table, boards, BOARD_MAX);
+    unsigned long missed = 0;
+    NetDatagram reply;
+    BenchRun run;
+    char extra[64];
+
+    if (bench_init(&run, "start_unicast", FAN_OUT_ROUNDS, 1) < 0) {
+        return -1;
+    }
+    bench_start(&run);
+    for (int i = 0; i < FAN_OUT_ROUNDS; i++) {
+        uint64_t begin = bench_now_ns();
+        for (int b = 0; b < count; b++) {
+            int acked = 0;
+            net_send(link, &boards[b].addr, "start", 5);
+            while (!acked && net_recv(link, &reply, 1000) == 1) {
+                acked = reply.len == 5 && reply.from.sin_addr.s_addr == boards[b].addr.sin_addr.s_addr &&
+                        reply.from.sin_port == boards[b].addr.sin_port;
+            }
+            missed += !acked;
+        }
+        bench_sample(&run, bench_now_ns() - begin);
+    }
+    bench_stop(&run, FAN_OUT_ROUNDS);
+
+    snprintf(extra, sizeof(extra), "\"boards\":%d,\"missed\":%lu", count, missed);
+    bench_report(&run, extra);
+    bench_free(&run);
+    return missed ? -1 : 0;
+}
+
+static int bench_discovery(NetLink *link) {
+    static BoardTable table;
+    NetConfig config = {256 * 1024, 0};
+    struct in_addr loopback = {htonl(INADDR_LOOPBACK)};
+    pthread_t thread;
+    int status = 0;
+
+    sim_board_count = FAN_OUT_BOARDS - 1;
+    atomic_store(&sim_running, 1);
+    for (int i = 0; i < sim_board_count; i++) {
+        if (sim_board_open(&sim_boards[i], i) < 0) {
+            return -1;
+        }
+    }
+    if (pthread_create(&thread, NULL, sim_board_thread, NULL) != 0 ||
+        board_table_open(&table, &config, DISCOVERY_GROUP, loopback, 0) < 0) {
+        fprintf(stderr, "Error: Failed to start discovery\n");
+        return -1;
+    }
+
+    status |= bench_fan_out(&table, "discover_boards", 0);
+    status |= bench_fan_out(&table, "start_fan_out", 1);
+    status |= bench_start_unicast(link, &table);
+
+    board_table_close(&table);
+    atomic_store(&sim_running, 0);
+    pthread_join(thread, NULL);
+    for (int i = 0; i < sim_board_count; i++) {
+        close(sim_boards[i].rx_fd);
+        close(sim_boards[i].tx_fd);
+    }
+    return status;
+}
+
+// "pump_telemetry": echo plus one 104 byte record, the smallest complete request/reply
+static int bench_round_trip(NetLink *link, const struct sockaddr_in *mcu) {
+    struct pump_telemetry telemetry;
+    unsigned long failed = 0;
+    BenchRun run;
+    char extra[32];
+
+    if (bench_init(&run, "udp_round_trip", ROUND_TRIPS, 1) < 0) {
+        return -1;
+    }
+    bench_start(&run);
+    for (int i = 0; i < ROUND_TRIPS; i++) {
+        uint64_t start = bench_now_ns();
+        failed += fetch_mcu_telemetry(link, mcu, &telemetry) < 0;
+        bench_sample(&run, bench_now_ns() - start);
+    }
+    bench_stop(&run, ROUND_TRIPS);
+
+    snprintf(extra, sizeof(extra), "\"failed\":%lu", failed);
+    bench_report(&run, extra);
+    bench_free(&run);
+    return failed ? -1 : 0;
+}
+
+// One sync round is a burst of "sync" exchanges, latency is per exchange
+static int bench_clock_sync(NetLink *link, const struct sockaddr_in *mcu) {
+    unsigned long failed = 0;
+    BenchRun run;
+    char extra[32];
+
+    if (bench_init(&run, "clock_sync", SYNC_ROUNDS, 8) < 0) {
+        return -1;
+    }
+    bench_start(&run);
+    for (int i = 0; i < SYNC_ROUNDS; i++) {
+        uint64_t start = bench_now_ns();
+        failed += sync_mcu_clock(link, mcu) < 0;
+        bench_sample(&run, bench_now_ns() - start);
+    }
+    bench_stop(&run, SYNC_ROUNDS * 8);
+
+    snprintf(extra, sizeof(extra), "\"failed\":%lu", failed);
+    bench_report(&run, extra);
+    bench_free(&run);
+    return failed ? -1 : 0;
+}
+
+// Incremental fetch of FETCH_SAMPLES new samples per sensor, latency is per fetched sample.
+// The rings are only filled between fetches, while the firmware thread is idle.
+static int bench_fetch(NetLink *link, const struct sockaddr_in *mcu) {
+    Device devices[] = {
+        {NULL, NULL, "Humidity", {0}, 0, 0, SENSOR_HUMIDITY, NULL, 67},
+        {NULL, NULL, "Saltiness", {0}, 0, 0, SENSOR_SALTINESS, NULL, 68},
+        {NULL, NULL, "Light", {0}, 0, 0, SENSOR_LIGHT, NULL, 44}
+    };
+    uint64_t fetched = 0, tick_us = 0;
+    unsigned long lost = 0, rx_calls = link->stats.rx_calls, rx_datagrams = link->stats.rx_datagrams;
+    BenchRun run;
+    char extra[128];
+
+    if (bench_init(&run, "fetch_samples", FETCH_ROUNDS, FETCH_SAMPLES * SENSOR_COUNT) < 0) {
+        return -1;
+    }
+    for (int s = 0; s < SENSOR_COUNT; s++) {
+        devices[s].remote_seq = sample_rings[s].next_seq;
+    }
+    bench_start(&run);
+    for (int round = 0; round < FETCH_ROUNDS; round++) {
+        uint32_t before[SENSOR_COUNT];
+        for (int s = 0; s < SENSOR_COUNT; s++) {
+            before[s] = devices[s].remote_seq;
+            for (int i = 0; i < FETCH_SAMPLES; i++) {
+                sample_ring_push(&sample_rings[s], (uint8_t)(i % 16), tick_us += 1000);
+            }
+        }
+
+        uint64_t start = bench_now_ns();
+        fetch_new_samples(link, mcu, devices, SENSOR_COUNT);
+        bench_sample(&run, bench_now_ns() - start);
+        for (int s = 0; s < SENSOR_COUNT; s++) {
+            fetched += devices[s].remote_seq - before[s];
+        }
+    }
+    bench_stop(&run, fetched);
+
+    for (int s = 0; s < SENSOR_COUNT; s++) {
+        lost += devices[s].remote_lost;
+    }
+    rx_calls = link->stats.rx_calls - rx_calls;
+    rx_datagrams = link->stats.rx_datagrams - rx_datagrams;
+    snprintf(extra, sizeof(extra), "\"per_fetch\":%d,\"lost\":%lu,\"rx_datagrams\":%lu,\"rx_per_syscall\":%.2f",
+             FETCH_SAMPLES * SENSOR_COUNT, lost, rx_datagrams, rx_calls ? (double)rx_datagrams / rx_calls : 0.0);
+    bench_report(&run, extra);
+    bench_free(&run);
+    remove("mcu_trace.txt");
+    return fetched == (uint64_t)FETCH_ROUNDS * FETCH_SAMPLES * SENSOR_COUNT ? 0 : -1;
+}
+
+// The MCU reboots halfway through: its rings count from 0 again, far below the gateway's cursors.
+// Every sample pushed after the restart must still be fetched, and none counted as lost.
+static int bench_fetch_restart(NetLink *link, const struct sockaddr_in *mcu) {
+    Device devices[] = {
+        {NULL, NULL, "Humidity", {0}, 0, 0, SENSOR_HUMIDITY, NULL, 67},
+        {NULL, NULL, "Saltiness", {0}, 0, 0, SENSOR_SALTINESS, NULL, 68},
+        {NULL, NULL, "Light", {0}, 0, 0, SENSOR_LIGHT, NULL, 44}
+    };
+    uint64_t fetched = 0, tick_us = 0;
+    unsigned long lost = 0, resets = 0, behind = 0;
+    BenchRun run;
+    char extra[96];
+
+    if (bench_init(&run, "fetch_ring_restart", RESTART_ROUNDS, FETCH_SAMPLES * SENSOR_COUNT) < 0) {
+        return -1;
+    }
+    for (int s = 0; s < SENSOR_COUNT; s++) {
+        devices[s].remote_seq = sample_rings[s].next_seq;
+    }
+    bench_start(&run);
+    for (int round = 0; round < RESTART_ROUNDS; round++) {
+        for (int s = 0; s < SENSOR_COUNT; s++) {
+            SampleRing *ring = &sample_rings[s];
+            if (round == RESTART_ROUNDS / 2) {
+                sample_ring_init(ring, ring->values, ring->ticks, ring->mask + 1); // As rtg_init() after a reset
+            }
+            for (int i = 0; i < FETCH_SAMPLES; i++) {
+                sample_ring_push(ring, (uint8_t)(i % 16), tick_us += 1000);
+            }
+        }
+
+        uint64_t start = bench_now_ns();
+        fetch_new_samples(link, mcu, devices, SENSOR_COUNT);
+        bench_sample(&run, bench_now_ns() - start);
+        for (int s = 0; s < SENSOR_COUNT; s++) {
+            if (devices[s].remote_seq == sample_rings[s].next_seq) {
+                fetched += FETCH_SAMPLES;
+            } else {
+                behind++;
+            }
+        }
+    }
+    bench_stop(&run, fetched);
+
+    for (int s = 0; s < SENSOR_COUNT; s++) {
+        lost += devices[s].remote_lost;
+        resets += devices[s].remote_resets;
+    }
+    snprintf(extra, sizeof(extra), "\"per_fetch\":%d,\"restarted_at\":%d,\"resets\":%lu,\"lost\":%lu,\"behind\":%lu",
+             FETCH_SAMPLES * SENSOR_COUNT, RESTART_ROUNDS / 2, resets, lost, behind);
+    bench_report(&run, extra);
+    bench_free(&run);
+    remove("mcu_trace.txt");
+    return behind == 0 && lost == 0 && resets == SENSOR_COUNT ? 0 : -1;
+}
+
+int main(void) {
+    static NetLink link;
+    NetConfig config = {256 * 1024, 0};
+    struct sockaddr_in mcu;
+    pthread_t thread;
+    int status = 0;
+
+    bench_quiet(); // Both sides print progress
+    rtg_init();
+    atomic_store(&firmware_running, 1);
+    if (pthread_create(&thread, NULL, firmware_thread, NULL) != 0) {
+        fprintf(stderr, "Error: Failed to start the firmware thread\n");
+        return EXIT_FAILURE;
+    }
+
+    if (net_open(&link, &config) < 0) {
+        fprintf(stderr, "Error: Failed to open the gateway socket\n");
+        return EXIT_FAILURE;
+    }
+    memset(&mcu, 0, sizeof(mcu));
+    mcu.sin_family = AF_INET;
+    mcu.sin_port = htons(MCU_PORT);
+    inet_pton(AF_INET, "127.0.0.1", &mcu.sin_addr);
+
+    status |= bench_round_trip(&link, &mcu);
+    status |= bench_clock_sync(&link, &mcu);
+    status |= bench_fetch(&link, &mcu);
+    status |= bench_fetch_restart(&link, &mcu);
+    status |= bench_discovery(&link);
+
+    atomic_store(&firmware_running, 0);
+    pthread_join(thread, NULL);
+    net_close(&link);
+    return status ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,249 @@
+// Gateway paths: GPIO vs MCU link join, sensor log write, and fan-in of N simulated boards
+// into the sample queue and into the gateway's batched UDP socket
+// Build: make -C bench
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include "bench.h"
+#include "../comparator.h"
+#include "../sample_queue.h"
+#include "../net_link.h"
+#include "../gateway.h"
+
+#define JOIN_FRAMES 100000         // Per sensor, one GPIO and one MCU sample each
+#define JOIN_BATCH 1000            // Frames per sensor between two waits for the workers
+#define JOIN_FRAME_NS 100000000ull // MCU frame spacing
+#define JOIN_SKEW_NS 3000000ull    // GPIO capture lags the MCU stamp by this much
+#define LOG_WRITES 20000
+#define FAN_IN_SAMPLES 200000      // Per board
+#define FAN_IN_QUEUE 4096
+#define FAN_IN_MAX_BOARDS 8
+#define UDP_FAN_IN_DATAGRAMS 20000 // Per board
+#define UDP_FAN_IN_SIZE 256        // A few dozen SampleRecords
+#define UDP_IDLE_MS 200            // Receiver gives up on the rest after this long without a datagram
+
+static int bench_link_join(void) {
+    static Comparator comparator;
+    unsigned long matched = 0, corrupt = 0;
+    BenchRun run;
+    char extra[96];
+
+    if (bench_init(&run, "link_join", JOIN_FRAMES / JOIN_BATCH, JOIN_BATCH * SENSOR_COUNT * 2) < 0 ||
+        comparator_start(&comparator, SENSOR_COUNT, 100000000ull, 500000000ull, FAN_IN_QUEUE) < 0) {
+        return -1;
+    }
+
+    // Every 97th frame arrives corrupted on the lines
+    bench_start(&run);
+    for (uint32_t i = 0; i < JOIN_FRAMES; i += JOIN_BATCH) {
+        uint64_t start = bench_now_ns();
+        for (uint32_t j = i; j < i + JOIN_BATCH; j++) {
+            for (int s = 0; s < SENSOR_COUNT; s++) {
+                uint8_t value = (uint8_t)((j * 7 + s) % 16);
+                Sample mcu = {(uint64_t)(j + 1) * JOIN_FRAME_NS, j, (uint8_t)s, value, ORIGIN_MCU};
+                Sample gpio = {mcu.ts_ns + JOIN_SKEW_NS, j, (uint8_t)s, j % 97 ? value : value ^ 1, ORIGIN_GPIO};
+                comparator_push(&comparator, &mcu);
+                comparator_push(&comparator, &gpio);
+            }
+        }
+        comparator_wait_idle(&comparator);
+        bench_sample(&run, bench_now_ns() - start);
+    }
+    bench_stop(&run, (uint64_t)JOIN_FRAMES * SENSOR_COUNT * 2);
+    comparator_stop(&comparator);
+
+    for (int s = 0; s < SENSOR_COUNT; s++) {
+        matched += atomic_load(&comparator.stats[s].matched);
+        corrupt += atomic_load(&comparator.stats[s].corrupt);
+    }
+    snprintf(extra, sizeof(extra), "\"workers\":%d,\"matched\":%lu,\"corrupt\":%lu", SENSOR_COUNT, matched, corrupt);
+    bench_report(&run, extra);
+    bench_free(&run);
+    return matched ? 0 : -1;
+}
+
+// What the writer thread does per sample: keep the value, rewrite the sensor log
+static int bench_log_write(void) {
+    Device device = {NULL, "bench_humidity_log.txt", "Humidity", {0}, 0, 0, SENSOR_HUMIDITY, NULL, 67};
+    BenchRun run;
+    char extra[32];
+
+    if (bench_init(&run, "log_write", LOG_WRITES, 1) < 0) {
+        return -1;
+    }
+    bench_start(&run);
+    for (uint32_t i = 0; i < LOG_WRITES; i++) {
+        Sample sample = {(uint64_t)i * 1000000, i, SENSOR_HUMIDITY, (uint8_t)(i % 16), ORIGIN_GPIO};
+        uint64_t start = bench_now_ns();
+        store_sample(&device, &sample);
+        write_log(&device);
+        bench_sample(&run, bench_now_ns() - start);
+    }
+    bench_stop(&run, LOG_WRITES);
+    snprintf(extra, sizeof(extra), "\"log_values\":%d", MAX_CHANGES);
+    bench_report(&run, extra);
+    bench_free(&run);
+
+    for (int i = 0; i < device.change_count; i++) {
+        free(device.changes[i]);
+    }
+    return 0;
+}
+
+typedef struct {
+    SampleQueue *queue;
+    uint8_t board;
+} Board;
+
+// One board: a stream of samples, each stamped right before it is queued
+static void *board_thread(void *arg) {
+    Board *board = arg;
+
+    for (uint32_t i = 0; i < FAN_IN_SAMPLES; i++) {
+        Sample sample = {bench_now_ns(), i, (uint8_t)(board->board % SENSOR_COUNT), (uint8_t)(i % 16), ORIGIN_GPIO};
+        queue_push(board->queue, &sample);
+    }
+    return NULL;
+}
+
+// N boards push into one QUEUE_BLOCK queue, the writer side pops batches and records queueing delay
+static int bench_fan_in(int boards) {
+    SampleQueue queue;
+    Board board[FAN_IN_MAX_BOARDS];
+    pthread_t threads[FAN_IN_MAX_BOARDS];
+    Sample batch[64];
+    uint64_t total = (uint64_t)boards * FAN_IN_SAMPLES, popped = 0;
+    char name[32], extra[96];
+    BenchRun run;
+
+    snprintf(name, sizeof(name), "fan_in_%d_boards", boards);
+    if (bench_init(&run, name, total, 1) < 0 || queue_init(&queue, FAN_IN_QUEUE, QUEUE_BLOCK) < 0) {
+        return -1;
+    }
+    bench_start(&run);
+    for (int i = 0; i < boards; i++) {
+        board[i] = (Board){&queue, (uint8_t)i};
+        pthread_create(&threads[i], NULL, board_thread, &board[i]);
+    }
+    while (popped < total) {
+        size_t count = queue_pop_batch(&queue, batch, sizeof(batch) / sizeof(batch[0]));
+        uint64_t now = bench_now_ns();
+        for (size_t i = 0; i < count; i++) {
+            bench_sample(&run, now - batch[i].ts_ns);
+        }
+        popped += count;
+    }
+    for (int i = 0; i < boards; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    bench_stop(&run, total);
+
+    snprintf(extra, sizeof(extra), "\"boards\":%d,\"blocked\":%lu", boards, atomic_load(&queue.blocked));
+    bench_report(&run, extra);
+    bench_free(&run);
+    queue_destroy(&queue);
+    return 0;
+}
+
+typedef struct {
+    struct sockaddr_in to;
+    int failed;
+} UdpBoard;
+
+// One board: datagrams carrying their send time, flushed NET_BATCH at a time like a board's burst
+static void *udp_board_thread(void *arg) {
+    UdpBoard *board = arg;
+    NetConfig config = {0, 0};
+    uint8_t payload[UDP_FAN_IN_SIZE] = {0};
+    NetLink link;
+
+    if (net_open(&link, &config) < 0) {
+        board->failed = 1;
+        return NULL;
+    }
+    for (int i = 0; i < UDP_FAN_IN_DATAGRAMS; i++) {
+        uint64_t now = bench_now_ns();
+        memcpy(payload, &now, sizeof(now));
+        net_queue(&link, &board->to, payload, sizeof(payload));
+    }
+    net_flush(&link);
+    net_close(&link);
+    return NULL;
+}
+
+// N boards send to one gateway socket, latency is send to net_recv() returning the datagram
+static int bench_udp_fan_in(int boards) {
+    static NetLink link;
+    NetConfig config = {256 * 1024, 0};
+    UdpBoard board[FAN_IN_MAX_BOARDS];
+    pthread_t threads[FAN_IN_MAX_BOARDS];
+    struct sockaddr_in addr = {0};
+    socklen_t addr_len = sizeof(addr);
+    uint64_t total = (uint64_t)boards * UDP_FAN_IN_DATAGRAMS, received = 0, queued_ns = 0, last_ns = 0;
+    NetDatagram datagram;
+    char name[32], extra[160];
+    BenchRun run;
+    int failed = 0;
+
+    snprintf(name, sizeof(name), "udp_fan_in_%d_boards", boards);
+    if (bench_init(&run, name, total, 1) < 0 || net_open(&link, &config) < 0) {
+        return -1;
+    }
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(link.fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        getsockname(link.fd, (struct sockaddr *)&addr, &addr_len) < 0) {
+        net_close(&link);
+        return -1;
+    }
+
+    bench_start(&run);
+    for (int i = 0; i < boards; i++) {
+        board[i] = (UdpBoard){addr, 0};
+        pthread_create(&threads[i], NULL, udp_board_thread, &board[i]);
+    }
+    // Datagrams the kernel dropped on a full buffer never show up, so stop once the senders went quiet
+    while (received + link.stats.kernel_drops < total && net_recv(&link, &datagram, UDP_IDLE_MS) > 0) {
+        uint64_t sent_ns, now = bench_now_ns();
+        memcpy(&sent_ns, datagram.data, sizeof(sent_ns));
+        bench_sample(&run, now - sent_ns);
+        queued_ns += now - datagram.rx_ns;
+        last_ns = now;
+        received++;
+    }
+    for (int i = 0; i < boards; i++) {
+        pthread_join(threads[i], NULL);
+        failed |= board[i].failed;
+    }
+    bench_stop(&run, received);
+    if (last_ns) {
+        run.elapsed_ns = last_ns - run.start_ns; // Not the idle wait for datagrams that were dropped
+    }
+
+    snprintf(extra, sizeof(extra), "\"boards\":%d,\"sent\":%llu,\"kernel_drops\":%lu,\"rx_per_syscall\":%.2f,"
+             "\"socket_wait_ns\":%llu", boards, (unsigned long long)total, link.stats.kernel_drops,
+             link.stats.rx_calls ? (double)link.stats.rx_datagrams / link.stats.rx_calls : 0.0,
+             (unsigned long long)(received ? queued_ns / received : 0));
+    bench_report(&run, extra);
+    bench_free(&run);
+    net_close(&link);
+    return failed || received == 0 ? -1 : 0;
+}
+
+int main(void) {
+    int status = 0;
+
+    bench_quiet(); // store_sample() prints every value
+    status |= bench_link_join();
+    status |= bench_log_write();
+    for (int boards = 1; boards <= FAN_IN_MAX_BOARDS; boards *= 2) {
+        status |= bench_fan_in(boards);
+    }
+    for (int boards = 1; boards <= FAN_IN_MAX_BOARDS; boards *= 2) {
+        status |= bench_udp_fan_in(boards);
+    }
+    remove("bench_humidity_log.txt");
+    return status ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,69 @@
+// Rules engine throughput: evaluates synthetic samples against rules.conf-style rules
+// Build: make -C bench (or gcc -O2 -o bench_rules bench_rules.c bench.c ../rules.c)
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "../rules.h"
+
+#define SAMPLE_COUNT 1000000
+#define BATCH 1000 // Samples per latency sample, one eval is well below the clock's resolution
+#define TARGET_RATE 100000 // Samples per second the gateway must sustain
+
+static const char *bench_rules =
+    "water humidity < 3 hyst 2 -> pump_on\n"
+    "dry humidity > 5 -> pump_off\n"
+    "salty saltiness > 7 -> alert\n"
+    "drying_out humidity rate < -20 -> alert\n"
+    "dark_dry light < 3 and humidity < 4 -> alert\n"
+    "bright light > 12 or saltiness > 14 -> pump_toggle\n";
+
+static unsigned long actions = 0;
+
+static void count_action(const Rule *rule, const Sample *sample, void *ctx) {
+    (void)rule;
+    (void)sample;
+    (void)ctx;
+    actions++;
+}
+
+int main(void) {
+    static RuleEngine engine;
+    BenchRun run;
+    Sample *samples = malloc(SAMPLE_COUNT * sizeof(Sample));
+    int value[SENSOR_COUNT] = {8, 8, 8};
+
+    rules_init(&engine, count_action, NULL);
+    if (!samples || rules_compile(&engine, bench_rules) < 0 ||
+        bench_init(&run, "rules_eval", SAMPLE_COUNT / BATCH, BATCH) < 0) {
+        fprintf(stderr, "Error: bench setup failed\n");
+        return EXIT_FAILURE;
+    }
+
+    // Random walk per sensor, 10 us apart, so thresholds keep being crossed
+    srand(1);
+    for (int i = 0; i < SAMPLE_COUNT; i++) {
+        int sensor = i % SENSOR_COUNT;
+        value[sensor] += rand() % 3 - 1;
+        value[sensor] = value[sensor] < 0 ? 0 : value[sensor] > 15 ? 15 : value[sensor];
+        samples[i] = (Sample){(uint64_t)i * 10000, (uint32_t)(i / SENSOR_COUNT), (uint8_t)sensor, (uint8_t)value[sensor]};
+    }
+
+    bench_start(&run);
+    for (int i = 0; i < SAMPLE_COUNT; i += BATCH) {
+        uint64_t start = bench_now_ns();
+        for (int j = i; j < i + BATCH; j++) {
+            rules_eval(&engine, &samples[j]);
+        }
+        bench_sample(&run, bench_now_ns() - start);
+    }
+    bench_stop(&run, SAMPLE_COUNT);
+
+    char extra[128];
+    double rate = bench_ops_per_s(&run);
+    snprintf(extra, sizeof(extra), "\"rules\":%d,\"actions\":%lu,\"target_met\":%s",
+             engine.rule_count, actions, rate >= TARGET_RATE ? "true" : "false");
+    bench_report(&run, extra);
+    bench_free(&run);
+    free(samples);
+    return rate >= TARGET_RATE ? EXIT_SUCCESS : EXIT_FAILURE;
+}
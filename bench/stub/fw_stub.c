@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "RTG.h"
+
+/*
+ * Host side of the RTG firmware: HAL, lwIP, cycle clock and BSRR DMA
+ * replaced by plain memory, a UDP socket and CLOCK_MONOTONIC, so RTG.c and
+ * server.c run unmodified in a thread of the bench. The socket binds the
+ * port on every address, like the board, and joins multicast groups on
+ * loopback only.
+ */
+
+#define STUB_POLL_MS 1 // ethernetif_input() waits this long for a datagram, instead of spinning
+
+typedef void (*udp_recv_fn)(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port);
+
+struct udp_pcb {
+    int fd;
+    udp_recv_fn recv;
+    void *arg;
+};
+
+GPIO_TypeDef stub_gpio[5];
+EXTI_TypeDef stub_exti;
+uint32_t SystemCoreClock = 216000000u;
+RNG_HandleTypeDef hrng;
+UART_HandleTypeDef huart3;
+struct netif gnetif;
+const ip_addr_t ip_addr_any = {0};
+
+static struct udp_pcb *bound_pcb; // The firmware has one server pcb
+static uint64_t clock_origin_ns;
+static unsigned rng_state = 1;
+static BsrrDmaDone dma_done;
+
+static uint64_t host_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+uint32_t HAL_GetTick(void) {
+    return (uint32_t)(host_ns() / 1000000u);
+}
+
+// A fixed made-up unique ID, the bench tells its boards apart by address
+uint32_t HAL_GetUIDw0(void) {
+    return 0x00470031u;
+}
+
+uint32_t HAL_GetUIDw1(void) {
+    return 0x34385111u;
+}
+
+uint32_t HAL_GetUIDw2(void) {
+    return 0x30353932u;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state) {
+    if (state == GPIO_PIN_SET) {
+        port->ODR |= pin;
+    } else {
+        port->ODR &= ~(uint32_t)pin;
+    }
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin) {
+    return ((port->IDR | port->ODR) & pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+HAL_StatusTypeDef HAL_RNG_GenerateRandomNumber(RNG_HandleTypeDef *rng, uint32_t *random) {
+    (void)rng;
+    *random = (uint32_t)rand_r(&rng_state);
+    return HAL_OK;
+}
+
+void Error_Handler(void) {
+    fprintf(stderr, "Error: firmware called Error_Handler()\n");
+    abort();
+}
+
+void cycle_clock_init(void) {
+    clock_origin_ns = host_ns();
+}
+
+uint64_t cycle_clock_cycles(void) {
+    return (host_ns() - clock_origin_ns) * (SystemCoreClock / 1000000u) / 1000u;
+}
+
+uint64_t cycle_clock_us(void) {
+    return (host_ns() - clock_origin_ns) / 1000u;
+}
+
+// The DMA plays a burst instantly here, the frames were already recorded by the caller
+void bsrr_dma_init(GPIO_TypeDef *ports[BSRR_MAX_PORTS], int port_count, BsrrDmaDone done) {
+    (void)ports;
+    (void)port_count;
+    dma_done = done;
+}
+
+int bsrr_dma_set_tick_ns(uint32_t tick_ns) {
+    return tick_ns > 0;
+}
+
+int bsrr_dma_start(uint32_t *tables[BSRR_MAX_PORTS], size_t words) {
+    (void)tables;
+    (void)words;
+    if (dma_done) {
+        dma_done();
+    }
+    return 1;
+}
+
+int bsrr_dma_busy(void) {
+    return 0;
+}
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type) {
+    (void)layer;
+    (void)type;
+    struct pbuf *p = malloc(sizeof(*p) + length);
+    if (!p) {
+        return NULL;
+    }
+    p->payload = p + 1;
+    p->len = length;
+    p->tot_len = length;
+    return p;
+}
+
+u8_t pbuf_free(struct pbuf *p) {
+    free(p);
+    return 1;
+}
+
+struct udp_pcb *udp_new(void) {
+    struct udp_pcb *pcb = calloc(1, sizeof(*pcb));
+    if (!pcb) {
+        return NULL;
+    }
+    pcb->fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (pcb->fd < 0) {
+        free(pcb);
+        return NULL;
+    }
+    return pcb;
+}
+
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port) {
+    struct sockaddr_in addr;
+    int reuse = 1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = ipaddr->addr;
+    setsockopt(pcb->fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(pcb->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("Firmware stub bind failed");
+        return ERR_USE;
+    }
+    bound_pcb = pcb;
+    return ERR_OK;
+}
+
+err_t igmp_joingroup(const ip4_addr_t *ifaddr, const ip4_addr_t *groupaddr) {
+    struct ip_mreq request;
+
+    (void)ifaddr;
+    if (!bound_pcb) {
+        return ERR_USE;
+    }
+    request.imr_multiaddr.s_addr = groupaddr->addr;
+    request.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+    if (setsockopt(bound_pcb->fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) < 0) {
+        perror("Firmware stub group join failed");
+        return ERR_USE;
+    }
+    return ERR_OK;
+}
+
+void udp_recv(struct udp_pcb *pcb, void *recv, void *recv_arg) {
+    pcb->recv = (udp_recv_fn)recv;
+    pcb->arg = recv_arg;
+}
+
+void udp_remove(struct udp_pcb *pcb) {
+    if (bound_pcb == pcb) {
+        bound_pcb = NULL;
+    }
+    close(pcb->fd);
+    free(pcb);
+}
+
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip, u16_t dst_port) {
+    struct sockaddr_in addr;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(dst_port);
+    addr.sin_addr.s_addr = dst_ip->addr;
+    return sendto(pcb->fd, p->payload, p->len, 0, (struct sockaddr *)&addr, sizeof(addr)) < 0 ? ERR_MEM : ERR_OK;
+}
+
+void ethernetif_input(struct netif *netif) {
+    uint8_t frame[2048];
+    struct sockaddr_in from;
+    socklen_t from_len = sizeof(from);
+    (void)netif;
+
+    if (!bound_pcb) {
+        return;
+    }
+    struct pollfd pfd = {bound_pcb->fd, POLLIN, 0};
+    if (poll(&pfd, 1, STUB_POLL_MS) <= 0) {
+        return;
+    }
+    ssize_t bytes = recvfrom(bound_pcb->fd, frame, sizeof(frame), 0, (struct sockaddr *)&from, &from_len);
+    if (bytes < 0 || !bound_pcb->recv) {
+        return;
+    }
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)bytes, PBUF_RAM);
+    if (!p) {
+        return;
+    }
+    memcpy(p->payload, frame, bytes);
+    ip_addr_t addr = {from.sin_addr.s_addr};
+    bound_pcb->recv(bound_pcb->arg, bound_pcb, p, &addr, ntohs(from.sin_port));
+}
+
+void sys_check_timeouts(void) {
+}
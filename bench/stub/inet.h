@@ -0,0 +1,8 @@
+#ifndef STUB_INET_H
+#define STUB_INET_H
+
+// Host stand-in for lwIP's inet.h, everything RTG.h needs is in lwip.h
+
+#include "lwip.h"
+
+#endif /* STUB_INET_H */
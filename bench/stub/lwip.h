@@ -0,0 +1,60 @@
+#ifndef STUB_LWIP_H
+#define STUB_LWIP_H
+
+/*
+ * Host stand-in for the lwIP raw API as RTG.c and server.c use it. A udp_pcb
+ * is a non-blocking UDP socket, ethernetif_input() hands at most one waiting
+ * datagram to the receive callback per call, like the board does per frame.
+ * IGMP joins become IP_ADD_MEMBERSHIP on loopback. The udp_* and igmp_*
+ * prototypes themselves come from RTG.h.
+ */
+
+#include <stdint.h>
+
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+typedef int8_t err_t;
+
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_USE -8
+
+typedef struct {
+    u32_t addr;           // Network byte order
+} ip4_addr_t;
+typedef ip4_addr_t ip_addr_t;
+
+extern const ip_addr_t ip_addr_any;
+#define IP_ADDR_ANY (&ip_addr_any)
+#define IP4_ADDR_ANY4 (&ip_addr_any)
+#define ip_addr_copy(dest, src) ((dest).addr = (src).addr)
+// Network byte order, on a little endian host
+#define IP4_ADDR(ipaddr, a, b, c, d) \
+    ((ipaddr)->addr = (u32_t)(a) | ((u32_t)(b) << 8) | ((u32_t)(c) << 16) | ((u32_t)(d) << 24))
+
+typedef enum {
+    PBUF_TRANSPORT
+} pbuf_layer;
+
+typedef enum {
+    PBUF_RAM
+} pbuf_type;
+
+struct pbuf {
+    void *payload;
+    u16_t len;
+    u16_t tot_len;
+};
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type);
+u8_t pbuf_free(struct pbuf *p);
+
+struct netif {
+    int unused;
+};
+
+void ethernetif_input(struct netif *netif);
+void sys_check_timeouts(void);
+
+#endif /* STUB_LWIP_H */
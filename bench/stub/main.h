@@ -0,0 +1,15 @@
+#ifndef STUB_MAIN_H
+#define STUB_MAIN_H
+
+// Host stand-in for Core/Inc/main.h, only the pins the RTG sources name
+
+#include "stm32f7xx_hal.h"
+
+#define USER_Btn_Pin GPIO_PIN_13
+#define USER_Btn_GPIO_Port GPIOC
+#define PUMP_Pin GPIO_PIN_8
+#define PUMP_GPIO_Port GPIOC
+
+void Error_Handler(void);
+
+#endif /* STUB_MAIN_H */
@@ -0,0 +1,75 @@
+#ifndef STUB_STM32F7XX_HAL_H
+#define STUB_STM32F7XX_HAL_H
+
+/*
+ * Host stand-in for the parts of the STM32F7 HAL that the RTG sources use.
+ * GPIO ports are plain memory, the tick and RNG come from the host; see
+ * fw_stub.c.
+ */
+
+#include <stdint.h>
+
+typedef enum {
+    HAL_OK = 0,
+    HAL_ERROR
+} HAL_StatusTypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct {
+    volatile uint32_t ODR;
+    volatile uint32_t IDR;
+    volatile uint32_t BSRR;
+} GPIO_TypeDef;
+
+typedef struct {
+    volatile uint32_t SWIER;
+} EXTI_TypeDef;
+
+typedef struct {
+    int unused;
+} RNG_HandleTypeDef;
+
+typedef struct {
+    int unused;
+} UART_HandleTypeDef;
+
+extern GPIO_TypeDef stub_gpio[5];
+#define GPIOA (&stub_gpio[0])
+#define GPIOB (&stub_gpio[1])
+#define GPIOC (&stub_gpio[2])
+#define GPIOD (&stub_gpio[3])
+#define GPIOE (&stub_gpio[4])
+
+extern EXTI_TypeDef stub_exti;
+#define EXTI (&stub_exti)
+
+#define GPIO_PIN_0 ((uint16_t)0x0001)
+#define GPIO_PIN_5 ((uint16_t)0x0020)
+#define GPIO_PIN_7 ((uint16_t)0x0080)
+#define GPIO_PIN_8 ((uint16_t)0x0100)
+#define GPIO_PIN_11 ((uint16_t)0x0800)
+#define GPIO_PIN_13 ((uint16_t)0x2000)
+#define GPIO_PIN_14 ((uint16_t)0x4000)
+
+#define HAL_MAX_DELAY 0xFFFFFFFFu
+
+extern uint32_t SystemCoreClock;
+
+// The firmware masks interrupts around state shared with its ISRs, the host has none
+#define __disable_irq() ((void)0)
+#define __enable_irq() ((void)0)
+
+uint32_t HAL_GetTick(void);
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin);
+uint32_t HAL_GetUIDw0(void);
+uint32_t HAL_GetUIDw1(void);
+uint32_t HAL_GetUIDw2(void);
+HAL_StatusTypeDef HAL_RNG_GenerateRandomNumber(RNG_HandleTypeDef *hrng, uint32_t *random);
+void HAL_GPIO_EXTI_Callback(uint16_t pin);
+
+#endif /* STUB_STM32F7XX_HAL_H */
@@ -0,0 +1,113 @@
+// Host test of the firmware's BSRR table builder
+// Build: make -C bench test
+#include <stdio.h>
+#include <stdint.h>
+#include "bsrr_table.h"
+#include "frame_tx.h"
+
+#define TICKS_PER_BIT 2
+#define GAP_TICKS 3
+#define FRAME_WORDS (1 + FRAME_TX_BITS * TICKS_PER_BIT + GAP_TICKS)
+#define FRAMES 2
+#define CAPACITY (FRAMES * FRAME_WORDS)
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+static int failures, checks;
+
+static void check(int ok, const char *what, int line) {
+    checks++;
+    if (!ok) {
+        failures++;
+        fprintf(stderr, "test_bsrr_table:%d: %s\n", line, what);
+    }
+}
+
+// BSRR: the low half sets pins, the high half resets them
+static uint32_t set(uint16_t pin) {
+    return pin;
+}
+
+static uint32_t reset(uint16_t pin) {
+    return (uint32_t)pin << 16;
+}
+
+// The firmware's layout: one sensor per port
+static void test_one_pin_per_port(void) {
+    static const BsrrPin pins[FRAME_TX_CHANNELS] = {{0, 0x0100}, {1, 0x0020}, {2, 0x0800}};
+    const BsrrLayout layout = {pins, FRAME_TX_CHANNELS, 3, TICKS_PER_BIT, GAP_TICKS};
+    const uint8_t values[FRAMES][FRAME_TX_CHANNELS] = {{0x1, 0xA, 0x6}, {0x8, 0x0, 0xF}};
+    uint32_t storage[3][CAPACITY];
+    uint32_t *tables[BSRR_MAX_PORTS] = {storage[0], storage[1], storage[2]};
+
+    CHECK(bsrr_frame_words(&layout) == FRAME_WORDS);
+    CHECK(bsrr_build(&layout, &values[0][0], FRAMES, tables, CAPACITY) == CAPACITY);
+
+    for (int port = 0; port < 3; port++) {
+        uint16_t pin = pins[port].pin_mask;
+        for (int frame = 0; frame < FRAMES; frame++) {
+            const uint32_t *words = tables[port] + frame * FRAME_WORDS;
+
+            CHECK(words[0] == reset(pin));                  // Start tick: falling edge
+            for (int bit = 0; bit < FRAME_TX_BITS; bit++) {
+                int level = (values[frame][port] >> bit) & 1;
+                for (int t = 0; t < TICKS_PER_BIT; t++) {
+                    CHECK(words[1 + bit * TICKS_PER_BIT + t] == (level ? set(pin) : reset(pin)));
+                }
+            }
+            for (int t = 0; t < GAP_TICKS; t++) {
+                CHECK(words[1 + FRAME_TX_BITS * TICKS_PER_BIT + t] == set(pin)); // Idle high
+            }
+        }
+    }
+
+    // LSB first, spelled out: humidity 0x1 is high only for bit 0, right after the start tick
+    CHECK(storage[0][1] == set(0x0100) && storage[0][2] == set(0x0100));
+    CHECK(storage[0][3] == reset(0x0100) && storage[0][1 + 3 * TICKS_PER_BIT] == reset(0x0100));
+}
+
+// Pins sharing a port change in the same word
+static void test_shared_port(void) {
+    static const BsrrPin pins[FRAME_TX_CHANNELS] = {{0, 0x0001}, {0, 0x0004}, {1, 0x0010}};
+    const BsrrLayout layout = {pins, FRAME_TX_CHANNELS, 2, TICKS_PER_BIT, GAP_TICKS};
+    const uint8_t values[FRAME_TX_CHANNELS] = {0x3, 0x5, 0x0};
+    uint32_t storage[2][FRAME_WORDS];
+    uint32_t *tables[BSRR_MAX_PORTS] = {storage[0], storage[1], NULL};
+
+    CHECK(bsrr_build(&layout, values, 1, tables, FRAME_WORDS) == FRAME_WORDS);
+    CHECK(storage[0][0] == (reset(0x0001) | reset(0x0004)));
+    CHECK(storage[0][1] == (set(0x0001) | set(0x0004)));                       // Bit 0: 1, 1
+    CHECK(storage[0][1 + TICKS_PER_BIT] == (set(0x0001) | reset(0x0004)));     // Bit 1: 1, 0
+    CHECK(storage[0][1 + 2 * TICKS_PER_BIT] == (reset(0x0001) | set(0x0004))); // Bit 2: 0, 1
+    CHECK(storage[0][1 + 3 * TICKS_PER_BIT] == (reset(0x0001) | reset(0x0004)));
+    CHECK(storage[0][FRAME_WORDS - 1] == (set(0x0001) | set(0x0004)));
+    CHECK(storage[1][1] == reset(0x0010));
+}
+
+// Refused layouts and a table that is too small leave 0
+static void test_limits(void) {
+    static const BsrrPin pins[FRAME_TX_CHANNELS] = {{0, 0x0001}, {1, 0x0002}, {2, 0x0004}};
+    const uint8_t values[FRAME_TX_CHANNELS] = {0};
+    uint32_t storage[3][FRAME_WORDS];
+    uint32_t *tables[BSRR_MAX_PORTS] = {storage[0], storage[1], storage[2]};
+    BsrrLayout layout = {pins, FRAME_TX_CHANNELS, 3, TICKS_PER_BIT, GAP_TICKS};
+
+    CHECK(bsrr_build(&layout, values, 1, tables, FRAME_WORDS - 1) == 0);
+    layout.gap_ticks = 0;
+    CHECK(bsrr_build(&layout, values, 1, tables, FRAME_WORDS) == 0);
+    layout.gap_ticks = GAP_TICKS;
+    layout.ticks_per_bit = 0;
+    CHECK(bsrr_build(&layout, values, 1, tables, FRAME_WORDS) == 0);
+    layout.ticks_per_bit = TICKS_PER_BIT;
+    layout.port_count = BSRR_MAX_PORTS + 1;
+    CHECK(bsrr_build(&layout, values, 1, tables, FRAME_WORDS) == 0);
+}
+
+int main(void) {
+    test_one_pin_per_port();
+    test_shared_port();
+    test_limits();
+
+    printf("test_bsrr_table: %d checks, %d failed\n", checks, failures);
+    return failures ? 1 : 0;
+}
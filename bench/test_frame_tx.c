@@ -0,0 +1,128 @@
+// Host test of the firmware's frame_tx state machine, driven by a fake tick
+// Build: make -C bench test
+#include <stdio.h>
+#include <stdint.h>
+#include "frame_tx.h"
+
+#define BIT_TICKS 50
+#define GAP_TICKS 600
+#define EVENTS_MAX 64
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+typedef struct {
+    uint32_t tick;
+    uint8_t levels;
+} LineEvent;
+
+static LineEvent events[EVENTS_MAX];
+static int event_count;
+static uint32_t fake_tick;
+static int failures, checks;
+static const uint8_t frame_values[2][FRAME_TX_CHANNELS] = {{0x5, 0xA, 0x3}, {0x8, 0x1, 0xF}};
+
+static void check(int ok, const char *what, int line) {
+    checks++;
+    if (!ok) {
+        failures++;
+        fprintf(stderr, "test_frame_tx:%d: %s\n", line, what);
+    }
+}
+
+static void next_frame(void *ctx, int index, uint8_t values[FRAME_TX_CHANNELS]) {
+    (void)ctx;
+    for (int c = 0; c < FRAME_TX_CHANNELS; c++) {
+        values[c] = frame_values[index % 2][c];
+    }
+}
+
+static void set_lines(void *ctx, uint8_t levels) {
+    (void)ctx;
+    if (event_count < EVENTS_MAX) {
+        events[event_count++] = (LineEvent){fake_tick, levels};
+    }
+}
+
+// Line levels of bit of a frame, bit c is channel c
+static uint8_t bit_levels(int frame, int bit) {
+    uint8_t levels = 0;
+    for (int c = 0; c < FRAME_TX_CHANNELS; c++) {
+        levels |= (uint8_t)(((frame_values[frame % 2][c] >> bit) & 1) << c);
+    }
+    return levels;
+}
+
+// The main loop spins much faster than the 1 ms tick, so every tick sees several polls
+static void run_until(FrameTx *tx, uint32_t end) {
+    for (; fake_tick != end; fake_tick++) {
+        for (int i = 0; i < 3; i++) {
+            frame_tx_poll(tx, fake_tick);
+        }
+    }
+}
+
+static void start_burst(FrameTx *tx, int frames, uint32_t start) {
+    const FrameTxOps ops = {next_frame, set_lines, NULL};
+
+    frame_tx_init(tx, &ops, BIT_TICKS, GAP_TICKS);
+    event_count = 0;
+    fake_tick = start;
+    CHECK(frame_tx_start(tx, frames, start) == 1);
+}
+
+// One frame's six line writes starting at event first: low, bits 0..3 one bit period apart, high
+static void check_frame(int first, int frame, uint32_t start) {
+    CHECK(events[first].tick == start && events[first].levels == 0);
+    for (int bit = 0; bit < FRAME_TX_BITS; bit++) {
+        CHECK(events[first + 1 + bit].tick == start + (uint32_t)bit * BIT_TICKS);
+        CHECK(events[first + 1 + bit].levels == bit_levels(frame, bit));
+    }
+    CHECK(events[first + 5].tick == start + FRAME_TX_BITS * BIT_TICKS);
+    CHECK(events[first + 5].levels == (1 << FRAME_TX_CHANNELS) - 1);
+}
+
+// Two frames on time: bit timing, LSB first, gap before the second frame, idle afterwards
+static void test_timing(uint32_t start) {
+    FrameTx tx;
+    uint32_t second = start + FRAME_TX_BITS * BIT_TICKS + GAP_TICKS;
+
+    start_burst(&tx, 2, start);
+    CHECK(frame_tx_start(&tx, 1, start) == 0);              // One burst at a time
+    CHECK(frame_tx_set_timing(&tx, 10, 10) == 0);           // No retiming mid-burst
+    run_until(&tx, second + FRAME_TX_BITS * BIT_TICKS + GAP_TICKS + 10);
+
+    CHECK(event_count == 12);
+    check_frame(0, 0, start);
+    check_frame(6, 1, second);
+    CHECK(!frame_tx_busy(&tx));
+    CHECK(frame_tx_set_timing(&tx, 10, 10) == 1);
+}
+
+// A poll 120 ticks late catches up on the missed bits at once, the rest of the frame keeps its
+// original deadlines instead of shifting by the delay
+static void test_late_poll(void) {
+    FrameTx tx;
+    uint32_t late = 2 * BIT_TICKS + 20;
+
+    start_burst(&tx, 1, 1000);
+    frame_tx_poll(&tx, fake_tick);
+    fake_tick += late;
+    run_until(&tx, 1000 + FRAME_TX_BITS * BIT_TICKS + GAP_TICKS + 10);
+
+    CHECK(event_count == 6);
+    CHECK(events[2].tick == 1000 + late && events[2].levels == bit_levels(0, 1));
+    CHECK(events[3].tick == 1000 + late && events[3].levels == bit_levels(0, 2));
+    CHECK(events[4].tick == 1000 + 3 * BIT_TICKS && events[4].levels == bit_levels(0, 3));
+    CHECK(events[5].tick == 1000 + FRAME_TX_BITS * BIT_TICKS);
+    CHECK(!frame_tx_busy(&tx));
+}
+
+int main(void) {
+    test_timing(5000);
+    test_late_poll();
+    test_timing(UINT32_MAX - 120);     // HAL_GetTick() wraps in the middle of the first frame
+    test_timing(UINT32_MAX - BIT_TICKS * FRAME_TX_BITS - GAP_TICKS + 1); // and right before the second
+
+    printf("test_frame_tx: %d checks, %d failed\n", checks, failures);
+    return failures ? 1 : 0;
+}
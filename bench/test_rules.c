@@ -0,0 +1,80 @@
+// Host test of the rules engine's edge-triggered firing
+// Build: make -C bench test
+#include <stdio.h>
+#include <stdint.h>
+#include "../rules.h"
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+static int failures, checks;
+static int actions;
+static uint64_t now_ns;
+
+static void check(int ok, const char *what, int line) {
+    checks++;
+    if (!ok) {
+        failures++;
+        fprintf(stderr, "test_rules:%d: %s\n", line, what);
+    }
+}
+
+static void count_action(const Rule *rule, const Sample *sample, void *ctx) {
+    (void)rule;
+    (void)sample;
+    (void)ctx;
+    actions++;
+}
+
+// Returns the actions rules_eval() reports, the callback has to agree
+static int feed(RuleEngine *engine, int sensor, int value) {
+    Sample sample = {0};
+    int before = actions;
+
+    now_ns += 100000000ull;
+    sample.ts_ns = now_ns;
+    sample.sensor = sensor;
+    sample.value = value;
+    int fired = rules_eval(engine, &sample);
+    CHECK(fired == actions - before);
+    return fired;
+}
+
+// Both terms of a band rule read the same sample: jumping across the band must not look like being inside
+// it for the one term that was updated first
+static void test_band_jump(void) {
+    RuleEngine engine;
+
+    rules_init(&engine, count_action, NULL);
+    CHECK(rules_compile(&engine, "band humidity > 3 and humidity < 6 -> alert\n") == 1);
+    CHECK(feed(&engine, SENSOR_HUMIDITY, 2) == 0);
+    CHECK(feed(&engine, SENSOR_HUMIDITY, 7) == 0);
+    CHECK(feed(&engine, SENSOR_HUMIDITY, 2) == 0);
+    CHECK(feed(&engine, SENSOR_HUMIDITY, 7) == 0);
+    CHECK(atomic_load(&engine.rules[0].fired) == 0);
+}
+
+// Entering the band fires once, staying in it does not fire again, leaving re-arms
+static void test_band_once(void) {
+    RuleEngine engine;
+
+    rules_init(&engine, count_action, NULL);
+    CHECK(rules_compile(&engine, "band humidity > 3 and humidity < 6 -> alert\n") == 1);
+    CHECK(feed(&engine, SENSOR_HUMIDITY, 2) == 0);
+    CHECK(feed(&engine, SENSOR_HUMIDITY, 5) == 1);
+    CHECK(feed(&engine, SENSOR_HUMIDITY, 5) == 0);
+    CHECK(feed(&engine, SENSOR_HUMIDITY, 4) == 0);
+    CHECK(feed(&engine, SENSOR_SALTINESS, 5) == 0);      // Other sensors leave it alone
+    CHECK(atomic_load(&engine.rules[0].fired) == 1);
+
+    CHECK(feed(&engine, SENSOR_HUMIDITY, 7) == 0);
+    CHECK(feed(&engine, SENSOR_HUMIDITY, 4) == 1);
+    CHECK(atomic_load(&engine.rules[0].fired) == 2);
+}
+
+int main(void) {
+    test_band_jump();
+    test_band_once();
+
+    printf("test_rules: %d checks, %d failed\n", checks, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include "board_table.h"
+
+#define DISCOVERY_PORT 50007 // SERVER_PORT in RTG.h, the group shares the command port
+
+static uint64_t monotonic_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static Board *find_board(BoardTable *table, const struct sockaddr_in *addr) {
+    for (int i = 0; i < table->count; i++) {
+        Board *board = &table->boards[i];
+        if (board->addr.sin_addr.s_addr == addr->sin_addr.s_addr && board->addr.sin_port == addr->sin_port) {
+            return board;
+        }
+    }
+    return NULL;
+}
+
+// A board the table has not seen yet gets a slot, unless the table is full
+static Board *add_board(BoardTable *table, const struct sockaddr_in *addr, uint64_t rx_ns) {
+    Board *board = find_board(table, addr);
+
+    if (board || table->count == BOARD_MAX) {
+        return board;
+    }
+    board = &table->boards[table->count++];
+    memset(board, 0, sizeof(*board));
+    board->addr = *addr;
+    board->first_seen_ns = rx_ns;
+    return board;
+}
+
+// Called with the lock held
+static void handle_reply(BoardTable *table, const NetDatagram *datagram) {
+    Board *board = NULL;
+
+    if (datagram->len == sizeof(BoardAnnounce) && memcmp(datagram->data, "DB", 2) == 0) {
+        board = add_board(table, &datagram->from, datagram->rx_ns);
+        if (board) {
+            memcpy(&board->announce, datagram->data, sizeof(BoardAnnounce));
+            board->announce_ns = datagram->rx_ns;
+            board->probe_rtt_ns = table->probe_ns && datagram->rx_ns > table->probe_ns ?
+                                  datagram->rx_ns - table->probe_ns : 0;
+        }
+    } else if (datagram->len == 5 && memcmp(datagram->data, "start", 5) == 0) {
+        // Boards that were not probed yet still count, the next probe fills in who they are
+        board = add_board(table, &datagram->from, datagram->rx_ns);
+        if (board && board->start_ack_ns < table->start_ns) {
+            board->start_ack_ns = datagram->rx_ns;
+        }
+    } else if (datagram->len == 8 && memcmp(datagram->data, "discover", 8) == 0) {
+        board = find_board(table, &datagram->from); // The echo ahead of the announce
+        if (!board) {
+            return;
+        }
+    }
+
+    if (board) {
+        board->last_seen_ns = datagram->rx_ns;
+        pthread_cond_broadcast(&table->replied);
+    } else {
+        table->unknown++;
+    }
+}
+
+// Called with the lock held
+static int send_to_group(BoardTable *table, const char *command, uint64_t *sent_ns) {
+    *sent_ns = monotonic_now_ns();
+    return net_send(&table->link, &table->group, command, strlen(command)) == 1 ? 0 : -1;
+}
+
+// Boards that stayed silent for BOARD_EXPIRE_PROBES probe periods, called with the lock held
+static void expire_boards(BoardTable *table, uint64_t now) {
+    uint64_t max_age = (uint64_t)table->probe_ms * BOARD_EXPIRE_PROBES * 1000000ull;
+
+    for (int i = 0; i < table->count;) {
+        if (now - table->boards[i].last_seen_ns > max_age) {
+            table->boards[i] = table->boards[--table->count];
+            table->expired++;
+        } else {
+            i++;
+        }
+    }
+}
+
+static void *collector_thread(void *arg) {
+    BoardTable *table = arg;
+    uint64_t next_probe = 0;
+    NetDatagram datagram;
+
+    while (atomic_load(&table->running)) {
+        if (table->probe_ms > 0) {
+            uint64_t now = monotonic_now_ns();
+            pthread_mutex_lock(&table->lock);
+            if (now >= next_probe) {
+                send_to_group(table, "discover", &table->probe_ns);
+                table->probes++;
+                next_probe = now + (uint64_t)table->probe_ms * 1000000ull;
+            }
+            expire_boards(table, now);
+            pthread_mutex_unlock(&table->lock);
+        }
+
+        // Whatever arrived together is handled under one lock
+        int got = net_recv(&table->link, &datagram, BOARD_POLL_MS);
+        if (got <= 0) {
+            continue;
+        }
+        pthread_mutex_lock(&table->lock);
+        do {
+            handle_reply(table, &datagram);
+        } while (net_recv(&table->link, &datagram, 0) == 1);
+        pthread_mutex_unlock(&table->lock);
+    }
+    return NULL;
+}
+
+int board_table_open(BoardTable *table, const NetConfig *config, const char *group, struct in_addr interface,
+                     int probe_ms) {
+    pthread_condattr_t attr;
+
+    memset(table, 0, sizeof(*table));
+    table->probe_ms = probe_ms;
+    table->group.sin_family = AF_INET;
+    table->group.sin_port = htons(DISCOVERY_PORT);
+    if (inet_pton(AF_INET, group, &table->group.sin_addr) != 1 || !IN_MULTICAST(ntohl(table->group.sin_addr.s_addr))) {
+        fprintf(stderr, "Error: %s is not a multicast group\n", group);
+        return -1;
+    }
+    if (net_open(&table->link, config) < 0) {
+        return -1;
+    }
+    if (net_multicast(&table->link, interface, 1) < 0) {
+        perror("Multicast setup failed");
+        net_close(&table->link);
+        return -1;
+    }
+
+    pthread_mutex_init(&table->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&table->replied, &attr);
+    pthread_condattr_destroy(&attr);
+    atomic_init(&table->running, 1);
+    if (pthread_create(&table->thread, NULL, collector_thread, table) != 0) {
+        net_close(&table->link);
+        return -1;
+    }
+    return 0;
+}
+
+void board_table_close(BoardTable *table) {
+    atomic_store(&table->running, 0);
+    pthread_join(table->thread, NULL);
+    net_close(&table->link);
+    pthread_cond_destroy(&table->replied);
+    pthread_mutex_destroy(&table->lock);
+}
+
+int board_table_probe(BoardTable *table) {
+    pthread_mutex_lock(&table->lock);
+    int status = send_to_group(table, "discover", &table->probe_ns);
+    table->probes++;
+    pthread_mutex_unlock(&table->lock);
+    return status;
+}
+
+int board_table_start_all(BoardTable *table) {
+    pthread_mutex_lock(&table->lock);
+    int status = send_to_group(table, "start", &table->start_ns);
+    table->starts++;
+    pthread_mutex_unlock(&table->lock);
+    return status;
+}
+
+// Boards that answered the latest probe, or acknowledged the latest start
+static int count_replies(const BoardTable *table, int start) {
+    uint64_t since = start ? table->start_ns : table->probe_ns;
+    int replies = 0;
+
+    for (int i = 0; i < table->count; i++) {
+        uint64_t rx_ns = start ? table->boards[i].start_ack_ns : table->boards[i].announce_ns;
+        replies += since && rx_ns >= since;
+    }
+    return replies;
+}
+
+static int wait_replies(BoardTable *table, int start, int boards, int timeout_ms) {
+    struct timespec deadline;
+    int replies;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&table->lock);
+    while ((replies = count_replies(table, start)) < boards &&
+           pthread_cond_timedwait(&table->replied, &table->lock, &deadline) == 0) {
+    }
+    replies = count_replies(table, start);
+    pthread_mutex_unlock(&table->lock);
+    return replies;
+}
+
+int board_table_wait_probe(BoardTable *table, int boards, int timeout_ms) {
+    return wait_replies(table, 0, boards, timeout_ms);
+}
+
+int board_table_wait_start(BoardTable *table, int boards, int timeout_ms) {
+    return wait_replies(table, 1, boards, timeout_ms);
+}
+
+int board_table_snapshot(BoardTable *table, Board *boards, int max) {
+    pthread_mutex_lock(&table->lock);
+    int count = table->count < max ? table->count : max;
+    memcpy(boards, table->boards, count * sizeof(Board));
+    pthread_mutex_unlock(&table->lock);
+    return count;
+}
+
+void board_table_print(BoardTable *table) {
+    uint64_t now = monotonic_now_ns();
+
+    pthread_mutex_lock(&table->lock);
+    printf("%d boards, %lu probes, %lu starts, %lu expired, %lu unknown datagrams\n",
+           table->count, table->probes, table->starts, table->expired, table->unknown);
+    for (int i = 0; i < table->count; i++) {
+        const Board *board = &table->boards[i];
+        const BoardAnnounce *announce = &board->announce;
+        char addr[INET_ADDRSTRLEN];
+
+        inet_ntop(AF_INET, &board->addr.sin_addr, addr, sizeof(addr));
+        printf("%2d: %s:%u", i, addr, ntohs(board->addr.sin_port));
+        if (announce->version) {
+            printf(" uid %08x%08x%08x, %u sensors, caps 0x%02x, ring %u, bit %u ms, debounce %u ms, up %.1f s",
+                   announce->uid[2], announce->uid[1], announce->uid[0], announce->sensors, announce->capabilities,
+                   announce->ring_capacity, announce->bit_ms, announce->debounce_ms, announce->uptime_us / 1e6);
+        } else {
+            printf(" not announced yet");
+        }
+        printf(", seen %.1f s ago", (now - board->last_seen_ns) / 1e9);
+        if (board->probe_rtt_ns) {
+            printf(", probe rtt %.3f ms", board->probe_rtt_ns / 1e6);
+        }
+        if (table->start_ns && board->start_ack_ns >= table->start_ns) {
+            printf(", start acked after %.3f ms", (board->start_ack_ns - table->start_ns) / 1e6);
+        }
+        printf("\n");
+    }
+    pthread_mutex_unlock(&table->lock);
+}
@@ -0,0 +1,92 @@
+#ifndef BOARD_TABLE_H
+#define BOARD_TABLE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <netinet/in.h>
+#include "net_link.h"
+
+/*
+ * Live table of the MCU boards on the network, kept by multicast discovery.
+ *
+ * Every board joins DISCOVERY_GROUP on its command port. The table has its
+ * own NetLink: "discover" sent to the group is answered by each board with
+ * a BoardAnnounce, "start" sent to the group starts a burst on all of them
+ * and each echo is that board's acknowledgement. So probing or starting N
+ * boards costs one datagram and one round trip instead of N exchanges.
+ *
+ * A collector thread receives all replies as they arrive and updates the
+ * table, the menu only sends and later looks. With probe_ms set it also
+ * re-probes on its own and drops boards that missed BOARD_EXPIRE_PROBES
+ * probes in a row, so boards come and go without a restart.
+ */
+
+#define DISCOVERY_GROUP "239.255.70.7" // DISCOVERY_GROUP in RTG.h
+#define BOARD_MAX 64
+#define BOARD_EXPIRE_PROBES 3
+#define BOARD_POLL_MS 50            // Collector wake-up for probes and expiry while idle
+
+// Reply to "discover", BoardAnnounce in RTG.h. Little endian.
+#define BOARD_ANNOUNCE_VERSION 1
+#define BOARD_CAP_FETCH 0x01
+#define BOARD_CAP_SYNC 0x02
+#define BOARD_CAP_TELEMETRY 0x04
+#define BOARD_CAP_CONFIG 0x08
+#define BOARD_CAP_DMA 0x10
+
+typedef struct __attribute__((packed)) {
+    char tag[2];                // "DB"
+    uint8_t version;
+    uint8_t sensors;
+    uint32_t uid[3];            // STM32 96-bit unique device ID
+    uint32_t capabilities;      // BOARD_CAP_* bits
+    uint32_t ring_capacity;     // Samples per sensor "fetch" can reach back
+    uint32_t bit_ms;
+    uint32_t debounce_ms;
+    uint64_t uptime_us;
+} BoardAnnounce;
+
+typedef struct {
+    struct sockaddr_in addr;    // Where its replies come from, unicast commands go here
+    BoardAnnounce announce;     // Latest one
+    uint64_t first_seen_ns;     // CLOCK_MONOTONIC, kernel receive times
+    uint64_t last_seen_ns;      // Any reply
+    uint64_t announce_ns;       // Receive time of the latest announce
+    uint64_t probe_rtt_ns;      // Latest "discover" to its announce
+    uint64_t start_ack_ns;      // Receive time of the echo to the latest "start", 0 if none yet
+} Board;
+
+typedef struct {
+    NetLink link;
+    struct sockaddr_in group;
+    int probe_ms;               // Automatic re-probe period, 0: only board_table_probe()
+    pthread_t thread;
+    atomic_int running;
+    pthread_mutex_t lock;       // Everything below, and sends on link
+    pthread_cond_t replied;     // Signalled on every announce and start acknowledgement
+    Board boards[BOARD_MAX];
+    int count;
+    uint64_t probe_ns;          // Send time of the latest "discover"
+    uint64_t start_ns;          // Send time of the latest "start"
+    unsigned long probes;
+    unsigned long starts;
+    unsigned long expired;      // Boards dropped for missing probes
+    unsigned long unknown;      // Datagrams that were neither, or from a board not in a full table
+} BoardTable;
+
+// Opens the socket with config, multicast goes out through interface (INADDR_ANY: routing table).
+// Starts the collector, which probes right away if probe_ms > 0.
+int board_table_open(BoardTable *table, const NetConfig *config, const char *group, struct in_addr interface,
+                     int probe_ms);
+void board_table_close(BoardTable *table);
+int board_table_probe(BoardTable *table);       // One "discover" to the group
+int board_table_start_all(BoardTable *table);   // One "start" to the group
+// Wait until boards have answered the latest probe / acknowledged the latest start, or timeout_ms
+// passed. Returns how many have.
+int board_table_wait_probe(BoardTable *table, int boards, int timeout_ms);
+int board_table_wait_start(BoardTable *table, int boards, int timeout_ms);
+int board_table_snapshot(BoardTable *table, Board *boards, int max); // Copy of the table, returns the count
+void board_table_print(BoardTable *table);
+
+#endif /* BOARD_TABLE_H */
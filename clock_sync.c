@@ -0,0 +1,73 @@
+#include <string.h>
+#include <time.h>
+#include "clock_sync.h"
+
+void clock_sync_init(ClockSync *sync) {
+    memset(sync, 0, sizeof(*sync));
+    sync->ns_per_us = 1000.0;
+}
+
+// Refit around the newest point so the doubles only ever hold differences
+static void clock_sync_fit(ClockSync *sync) {
+    int newest = (sync->next + CLOCK_SYNC_POINTS - 1) % CLOCK_SYNC_POINTS;
+    uint64_t x0 = sync->tick_us[newest];
+    uint64_t y0 = sync->mono_ns[newest];
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    double slope = 1000.0;
+
+    for (int i = 0; i < sync->count; i++) {
+        double x = (double)(int64_t)(sync->tick_us[i] - x0);
+        double y = (double)(int64_t)(sync->mono_ns[i] - y0);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    double n = sync->count;
+    double var = sxx - sx * sx / n;
+    if (sync->count > 1 && var > 0) {
+        double fitted = (sxy - sx * sy / n) / var;
+        if (fitted > 1000.0 * (1 - CLOCK_SYNC_MAX_PPM / 1e6) && fitted < 1000.0 * (1 + CLOCK_SYNC_MAX_PPM / 1e6)) {
+            slope = fitted;
+        }
+    }
+
+    sync->ns_per_us = slope;
+    sync->base_tick_us = x0;
+    sync->base_mono_ns = (int64_t)y0 + (int64_t)((sy - slope * sx) / n);
+    sync->valid = 1;
+}
+
+void clock_sync_add(ClockSync *sync, uint64_t t1_ns, uint64_t t2_us, uint64_t t3_us, uint64_t t4_ns) {
+    uint64_t tick = t2_us + (t3_us - t2_us) / 2;
+
+    if (sync->count > 0 && tick < sync->last_tick_us) {
+        clock_sync_init(sync); // MCU restarted, its ticks began again at 0
+    }
+    sync->last_tick_us = tick;
+    sync->delay_ns = (t4_ns - t1_ns) - (t3_us - t2_us) * 1000;
+    sync->tick_us[sync->next] = tick;
+    sync->mono_ns[sync->next] = t1_ns + (t4_ns - t1_ns) / 2;
+    sync->next = (sync->next + 1) % CLOCK_SYNC_POINTS;
+    if (sync->count < CLOCK_SYNC_POINTS) {
+        sync->count++;
+    }
+    clock_sync_fit(sync);
+}
+
+uint64_t clock_sync_to_monotonic(const ClockSync *sync, uint64_t tick_us) {
+    double delta = (double)(int64_t)(tick_us - sync->base_tick_us) * sync->ns_per_us;
+    return (uint64_t)(sync->base_mono_ns + (int64_t)delta);
+}
+
+double clock_sync_drift_ppm(const ClockSync *sync) {
+    return (1000.0 / sync->ns_per_us - 1.0) * 1e6;
+}
+
+uint64_t monotonic_to_realtime(uint64_t mono_ns) {
+    struct timespec mono, real;
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    clock_gettime(CLOCK_REALTIME, &real);
+    int64_t offset = ((int64_t)real.tv_sec - mono.tv_sec) * 1000000000ll + (real.tv_nsec - mono.tv_nsec);
+    return (uint64_t)((int64_t)mono_ns + offset);
+}
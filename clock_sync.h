@@ -0,0 +1,43 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <stdint.h>
+
+/*
+ * Maps MCU sample ticks (microseconds of its DWT cycle clock) onto the
+ * gateway's CLOCK_MONOTONIC.
+ *
+ * Each sync round is a few NTP style exchanges: the gateway sends t1, the
+ * MCU stamps receive (t2) and transmit (t3), the gateway stamps the reply
+ * at t4. The exchange with the smallest round trip delay gives one point
+ * (MCU midpoint, gateway midpoint). A least squares line through the last
+ * rounds' points gives drift (slope) and offset; with a single point the
+ * nominal rate is assumed. A tick going backwards means the MCU restarted
+ * and the history is dropped.
+ */
+
+#define CLOCK_SYNC_POINTS 16
+#define CLOCK_SYNC_MAX_PPM 500.0 // Fits steeper than this are treated as noise
+
+typedef struct {
+    uint64_t tick_us[CLOCK_SYNC_POINTS];
+    uint64_t mono_ns[CLOCK_SYNC_POINTS];
+    int count;
+    int next;             // Oldest point, overwritten by the next round
+    uint64_t last_tick_us;
+    uint64_t delay_ns;    // Round trip of the latest point
+    // mono_ns = base_mono_ns + (tick_us - base_tick_us) * ns_per_us
+    uint64_t base_tick_us;
+    int64_t base_mono_ns;
+    double ns_per_us;
+    int valid;
+} ClockSync;
+
+void clock_sync_init(ClockSync *sync);
+// Add one round's best exchange: t1/t4 gateway CLOCK_MONOTONIC ns, t2/t3 MCU us
+void clock_sync_add(ClockSync *sync, uint64_t t1_ns, uint64_t t2_us, uint64_t t3_us, uint64_t t4_ns);
+uint64_t clock_sync_to_monotonic(const ClockSync *sync, uint64_t tick_us);
+double clock_sync_drift_ppm(const ClockSync *sync); // Positive when the MCU clock runs fast
+uint64_t monotonic_to_realtime(uint64_t mono_ns);
+
+#endif /* CLOCK_SYNC_H */
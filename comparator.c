@@ -0,0 +1,252 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "comparator.h"
+
+#define SKEW_GAIN_SHIFT 3 // Learned skew moves 1/8 of the way to each new match
+
+static void stats_init(JoinStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    atomic_init(&stats->skew_min_ns, INT64_MAX);
+    atomic_init(&stats->skew_max_ns, INT64_MIN);
+}
+
+// Window of GPIO - MCU delays a pair may have
+static void skew_bounds(const Comparator *comparator, const JoinState *join, int64_t *low, int64_t *high) {
+    int64_t tolerance = (int64_t)comparator->tolerance_ns;
+    if (join->have_skew) {
+        *low = join->skew_ns - tolerance;
+        *high = join->skew_ns + tolerance;
+    } else {
+        *low = -tolerance;
+        *high = (int64_t)comparator->max_latency_ns;
+    }
+}
+
+static void remove_pending(JoinState *join, int origin, int index) {
+    memmove(&join->pending[origin][index], &join->pending[origin][index + 1],
+            (join->pending_count[origin] - index - 1) * sizeof(Sample));
+    join->pending_count[origin]--;
+}
+
+// Were the lines being read around ts, i.e. was a GPIO frame decoded within observe_gap on both sides?
+static int gpio_observed(const Comparator *comparator, const JoinState *join, uint64_t ts_ns) {
+    int64_t gap = (int64_t)comparator->observe_gap_ns;
+    int before = 0, after = 0;
+
+    for (int i = 0; i < JOIN_WINDOW; i++) {
+        if (!join->gpio_seen[i]) {
+            continue;
+        }
+        int64_t delta = (int64_t)(join->gpio_seen[i] - ts_ns) - join->skew_ns;
+        before |= delta < 0 && delta >= -gap;
+        after |= delta > 0 && delta <= gap;
+    }
+    return before && after;
+}
+
+static void judge_unmatched(const Comparator *comparator, JoinState *join, JoinStats *stats, const Sample *sample) {
+    if (sample->origin == ORIGIN_GPIO) {
+        atomic_fetch_add_explicit(&stats->spurious, 1, memory_order_relaxed);
+    } else if (gpio_observed(comparator, join, sample->ts_ns)) {
+        atomic_fetch_add_explicit(&stats->lost, 1, memory_order_relaxed);
+    } else {
+        atomic_fetch_add_explicit(&stats->unobserved, 1, memory_order_relaxed);
+    }
+}
+
+// Drop pending samples of origin that no future sample of the other stream can match
+static void expire_pending(const Comparator *comparator, JoinState *join, JoinStats *stats, int origin) {
+    int64_t low, high;
+    uint64_t other = join->watermark[!origin];
+
+    skew_bounds(comparator, join, &low, &high);
+    while (join->pending_count[origin] > 0) {
+        const Sample *oldest = &join->pending[origin][0];
+        // A partner of an MCU sample has ts <= mcu + high, one of a GPIO sample has ts >= gpio - low
+        int expired = origin == ORIGIN_MCU ? (int64_t)(other - oldest->ts_ns) > high
+                                           : (int64_t)(other - oldest->ts_ns) > -low;
+        if (!expired) {
+            break;
+        }
+        judge_unmatched(comparator, join, stats, oldest);
+        remove_pending(join, origin, 0);
+    }
+}
+
+static void record_match(JoinState *join, JoinStats *stats, const Sample *gpio, const Sample *mcu) {
+    int64_t skew = (int64_t)(gpio->ts_ns - mcu->ts_ns);
+    int64_t seq_offset = (int64_t)mcu->seq - (int64_t)gpio->seq;
+    long long bound;
+
+    atomic_fetch_add_explicit(&stats->matched, 1, memory_order_relaxed);
+    if (gpio->value != mcu->value) {
+        atomic_fetch_add_explicit(&stats->corrupt, 1, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&stats->skew_sum_ns, skew, memory_order_relaxed);
+    bound = atomic_load_explicit(&stats->skew_min_ns, memory_order_relaxed);
+    if (skew < bound) {
+        atomic_store_explicit(&stats->skew_min_ns, skew, memory_order_relaxed);
+    }
+    bound = atomic_load_explicit(&stats->skew_max_ns, memory_order_relaxed);
+    if (skew > bound) {
+        atomic_store_explicit(&stats->skew_max_ns, skew, memory_order_relaxed);
+    }
+
+    if (join->have_skew) {
+        join->skew_ns += (skew - join->skew_ns) >> SKEW_GAIN_SHIFT;
+    } else {
+        join->skew_ns = skew;
+        join->have_skew = 1;
+    }
+    if (join->have_seq_offset && seq_offset != join->seq_offset) {
+        atomic_fetch_add_explicit(&stats->seq_slips, 1, memory_order_relaxed);
+    }
+    join->seq_offset = seq_offset;
+    join->have_seq_offset = 1;
+}
+
+static void join_sample(Comparator *comparator, const Sample *sample) {
+    JoinState *join = &comparator->join[sample->sensor];
+    JoinStats *stats = &comparator->stats[sample->sensor];
+    int origin = sample->origin == ORIGIN_MCU ? ORIGIN_MCU : ORIGIN_GPIO;
+    int other = !origin;
+    int64_t low, high;
+
+    atomic_fetch_add_explicit(origin == ORIGIN_MCU ? &stats->mcu : &stats->gpio, 1, memory_order_relaxed);
+    if (sample->ts_ns > join->watermark[origin]) {
+        join->watermark[origin] = sample->ts_ns;
+    }
+    if (origin == ORIGIN_GPIO) {
+        join->gpio_seen[join->gpio_seen_next] = sample->ts_ns;
+        join->gpio_seen_next = (join->gpio_seen_next + 1) % JOIN_WINDOW;
+    }
+
+    // Closest partner to the expected skew among the other stream's pending samples
+    skew_bounds(comparator, join, &low, &high);
+    int best = -1;
+    int64_t best_error = INT64_MAX;
+    for (int i = 0; i < join->pending_count[other]; i++) {
+        const Sample *candidate = &join->pending[other][i];
+        int64_t skew = origin == ORIGIN_GPIO ? (int64_t)(sample->ts_ns - candidate->ts_ns)
+                                             : (int64_t)(candidate->ts_ns - sample->ts_ns);
+        int64_t error = join->have_skew ? llabs(skew - join->skew_ns) : llabs(skew);
+        if (skew >= low && skew <= high && error < best_error) {
+            best = i;
+            best_error = error;
+        }
+    }
+
+    if (best >= 0) {
+        const Sample *partner = &join->pending[other][best];
+        record_match(join, stats, origin == ORIGIN_GPIO ? sample : partner, origin == ORIGIN_GPIO ? partner : sample);
+        remove_pending(join, other, best);
+    } else {
+        if (join->pending_count[origin] == JOIN_WINDOW) {
+            atomic_fetch_add_explicit(&stats->evicted, 1, memory_order_relaxed);
+            remove_pending(join, origin, 0);
+        }
+        join->pending[origin][join->pending_count[origin]++] = *sample;
+    }
+    expire_pending(comparator, join, stats, other);
+}
+
+static void *comparator_worker(void *arg) {
+    ComparatorShard *shard = arg;
+    Sample batch[COMPARATOR_BATCH];
+    struct timespec idle = {0, 1000000}; // 1 ms
+
+    for (;;) {
+        // Same drain-then-stop order as the log writer
+        int running = atomic_load(&shard->comparator->running);
+        size_t count = queue_pop_batch(&shard->queue, batch, COMPARATOR_BATCH);
+        if (count == 0) {
+            if (!running) {
+                break;
+            }
+            nanosleep(&idle, NULL);
+            continue;
+        }
+        for (size_t i = 0; i < count; i++) {
+            join_sample(shard->comparator, &batch[i]);
+        }
+        atomic_fetch_add(&shard->processed, count);
+    }
+    return NULL;
+}
+
+int comparator_start(Comparator *comparator, int workers, uint64_t tolerance_ns, uint64_t max_latency_ns,
+                     size_t queue_capacity) {
+    if (workers < 1) {
+        workers = 1;
+    }
+    if (workers > SENSOR_COUNT) {
+        workers = SENSOR_COUNT;
+    }
+
+    memset(comparator->join, 0, sizeof(comparator->join));
+    for (int s = 0; s < SENSOR_COUNT; s++) {
+        stats_init(&comparator->stats[s]);
+    }
+    comparator->workers = workers;
+    comparator->tolerance_ns = tolerance_ns;
+    comparator->max_latency_ns = max_latency_ns;
+    comparator->observe_gap_ns = 2 * max_latency_ns + tolerance_ns;
+    comparator->queue_capacity = queue_capacity;
+    atomic_init(&comparator->running, 1);
+
+    comparator->shards = calloc(workers, sizeof(ComparatorShard));
+    if (!comparator->shards) {
+        return -1;
+    }
+    for (int i = 0; i < workers; i++) {
+        ComparatorShard *shard = &comparator->shards[i];
+        shard->comparator = comparator;
+        atomic_init(&shard->processed, 0);
+        if (queue_init(&shard->queue, queue_capacity, QUEUE_BLOCK) < 0 ||
+            pthread_create(&shard->thread, NULL, comparator_worker, shard) != 0) {
+            comparator->workers = i;
+            queue_destroy(&shard->queue);
+            comparator_stop(comparator);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void comparator_push(Comparator *comparator, const Sample *sample) {
+    if (sample->sensor >= SENSOR_COUNT || comparator->workers == 0) {
+        return;
+    }
+    queue_push(&comparator->shards[sample->sensor % comparator->workers].queue, sample);
+}
+
+void comparator_wait_idle(Comparator *comparator) {
+    struct timespec idle = {0, 1000000}; // 1 ms
+
+    for (int i = 0; i < comparator->workers; i++) {
+        ComparatorShard *shard = &comparator->shards[i];
+        while (atomic_load(&shard->processed) < atomic_load(&shard->queue.pushed)) {
+            nanosleep(&idle, NULL);
+        }
+    }
+}
+
+void comparator_stop(Comparator *comparator) {
+    atomic_store(&comparator->running, 0);
+    for (int i = 0; i < comparator->workers; i++) {
+        pthread_join(comparator->shards[i].thread, NULL);
+        queue_destroy(&comparator->shards[i].queue);
+    }
+    free(comparator->shards);
+    comparator->shards = NULL;
+    comparator->workers = 0;
+}
+
+int comparator_reset(Comparator *comparator) {
+    int workers = comparator->workers;
+
+    comparator_stop(comparator);
+    return comparator_start(comparator, workers, comparator->tolerance_ns, comparator->max_latency_ns,
+                            comparator->queue_capacity);
+}
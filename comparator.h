@@ -0,0 +1,93 @@
+#ifndef COMPARATOR_H
+#define COMPARATOR_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include "sample.h"
+#include "sample_queue.h"
+
+/*
+ * Streaming link check: joins the samples decoded from the GPIO lines with
+ * the ones the MCU reports over UDP, per sensor, while both keep flowing.
+ *
+ * Samples are pushed from any thread and routed to the worker that owns
+ * their sensor (sensor % workers), each worker has its own SampleQueue and
+ * join state, so shards never share anything but their counters.
+ *
+ * A GPIO sample matches an MCU sample of the same sensor when it was
+ * captured skew +- tolerance after it. skew is learned from the matches
+ * (the sysfs path reports a frame only after it was decoded); before the
+ * first match anything between -tolerance and max_latency is accepted.
+ * Unmatched samples wait in a bounded window until the other stream's
+ * newest timestamp shows that no partner can arrive any more:
+ *   - an MCU sample with no GPIO partner is lost on the lines, unless the
+ *     GPIO side did not decode frames both shortly before and after it
+ *     (it was not being read then: unobserved),
+ *   - a GPIO sample with no MCU partner is spurious,
+ *   - a matched pair with different values is corrupt.
+ * The sequence offset between matched pairs is tracked as well, a change
+ * means one side skipped or repeated a number.
+ */
+
+#define JOIN_WINDOW 64          // Unmatched samples held per sensor and stream
+#define COMPARATOR_BATCH 64
+
+typedef struct {
+    atomic_ulong gpio;          // Samples seen per stream
+    atomic_ulong mcu;
+    atomic_ulong matched;
+    atomic_ulong corrupt;       // Matched, but the values differ
+    atomic_ulong lost;          // MCU sample never decoded from the lines
+    atomic_ulong spurious;      // Decoded frame the MCU never reported
+    atomic_ulong unobserved;    // MCU sample from a time the lines were not read
+    atomic_ulong evicted;       // Pushed out of a full window before it could be judged
+    atomic_ulong seq_slips;
+    atomic_llong skew_sum_ns;   // GPIO capture minus MCU timestamp over matches
+    atomic_llong skew_min_ns;
+    atomic_llong skew_max_ns;
+} JoinStats;
+
+typedef struct {
+    Sample pending[2][JOIN_WINDOW]; // Unmatched samples per SampleOrigin, oldest first
+    int pending_count[2];
+    uint64_t watermark[2];          // Newest timestamp seen per origin
+    uint64_t gpio_seen[JOIN_WINDOW]; // Recent GPIO timestamps, to tell lost from unobserved
+    int gpio_seen_next;
+    int64_t skew_ns;                // Learned GPIO - MCU delay
+    int have_skew;
+    int64_t seq_offset;
+    int have_seq_offset;
+} JoinState;
+
+typedef struct Comparator Comparator;
+
+typedef struct {
+    Comparator *comparator;
+    SampleQueue queue;
+    pthread_t thread;
+    atomic_ulong processed;         // Samples joined, compared with queue.pushed
+} ComparatorShard;
+
+struct Comparator {
+    ComparatorShard *shards;
+    int workers;
+    uint64_t tolerance_ns;
+    uint64_t max_latency_ns;
+    uint64_t observe_gap_ns;        // GPIO silence longer than this means the lines were not read
+    size_t queue_capacity;
+    atomic_int running;
+    JoinState join[SENSOR_COUNT];   // join[s] is only touched by the shard owning s
+    JoinStats stats[SENSOR_COUNT];
+};
+
+int comparator_start(Comparator *comparator, int workers, uint64_t tolerance_ns, uint64_t max_latency_ns,
+                     size_t queue_capacity);
+void comparator_push(Comparator *comparator, const Sample *sample); // sample->origin selects the stream
+void comparator_wait_idle(Comparator *comparator); // Until everything pushed so far has been joined
+void comparator_stop(Comparator *comparator); // Drains the queues, unmatched samples stay pending
+// Start over with empty windows, no learned skew and zeroed counters, e.g. for another MCU.
+// Nothing may push meanwhile.
+int comparator_reset(Comparator *comparator);
+
+#endif /* COMPARATOR_H */
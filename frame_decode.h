@@ -0,0 +1,36 @@
+#ifndef FRAME_DECODE_H
+#define FRAME_DECODE_H
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+#endif
+
+/*
+ * Frame decode of the sensor modules' work_handler(), free of kernel
+ * calls so the bench can run it against a simulated line.
+ *
+ * The falling start edge has already been seen. Bit i (LSB first) is the
+ * line level read, then the decoder waits one slot before the next read.
+ */
+
+#define FRAME_DECODE_BITS 4
+
+typedef int (*frame_read_fn)(void *ctx);                        // Current line level
+typedef void (*frame_wait_fn)(void *ctx, unsigned int slot_ms); // Sleep one slot
+
+static inline uint8_t frame_decode(frame_read_fn read, frame_wait_fn wait, void *ctx, unsigned int slot_ms) {
+    uint8_t value = 0;
+    int i;
+
+    for (i = 0; i < FRAME_DECODE_BITS; i++) {
+        if (read(ctx)) {
+            value |= (uint8_t)(1u << i);
+        }
+        wait(ctx, slot_ms);
+    }
+    return value;
+}
+
+#endif /* FRAME_DECODE_H */
@@ -0,0 +1,83 @@
+#ifndef GATEWAY_H
+#define GATEWAY_H
+
+#include <stdint.h>
+#include <arpa/inet.h>
+#include "rules.h"
+#include "source.h"
+#include "pump_telemetry.h"
+#include "net_link.h"
+
+/*
+ * The gateway's per-sensor state, the MCU's UDP reply layouts and the
+ * UDP.c entry points. main() is only the menu around these, so the bench
+ * programs link UDP.c (with main renamed) and drive the same paths.
+ */
+
+#define MAX_CHANGES 10 // Values kept per sensor log
+
+typedef struct {
+    char *device_path;
+    char *log_file;
+    char *sensor_name;
+    char *changes[MAX_CHANGES];
+    int change_count;
+    int monitoring; // Flag to control monitoring
+    SensorId sensor;
+    SensorSource *source; // Live sysfs source, opened when monitoring starts
+    int pin;              // Global GPIO number from am335x-bonegreen.dts
+    uint32_t remote_seq;  // Next MCU sample sequence number not fetched yet
+    unsigned long remote_lost; // MCU samples overwritten before they were fetched
+    unsigned long remote_resets; // Times the MCU's ring started over below remote_seq, e.g. after a reboot
+} Device;
+
+// Header of a "fetch" reply datagram, must match SampleBatchHeader in RTG.h
+typedef struct __attribute__((packed)) {
+    char tag[2];          // "ST"
+    uint8_t sensor;
+    uint8_t last;         // Final datagram for this sensor in this reply
+    uint32_t first_seq;
+    uint32_t next_seq;
+    uint16_t count;
+} SampleBatchHeader;
+
+// One fetched sample, must match SampleRecord in RTG.h
+typedef struct __attribute__((packed)) {
+    uint64_t tick_us;     // MCU cycle clock at the frame's start edge
+    uint8_t value;
+} SampleRecord;
+
+// Reply to "sync <ns>", must match ClockSyncReply in RTG.h
+typedef struct __attribute__((packed)) {
+    char tag[2];          // "CS"
+    uint64_t request_ns;
+    uint64_t rx_us;
+    uint64_t tx_us;
+} ClockSyncReply;
+
+int pump_open();
+void pump_set(int on);
+int pump_get();
+void run_rule_action(const Rule *rule, const Sample *sample, void *ctx);
+void load_rules();
+void print_pump_stats();
+void print_pump_telemetry(const char *origin, const struct pump_telemetry *telemetry);
+int read_local_telemetry(struct pump_telemetry *telemetry);
+int fetch_mcu_telemetry(NetLink *link, const struct sockaddr_in *server_addr, struct pump_telemetry *telemetry);
+void delete_specific_files();
+void store_sample(Device *device, const Sample *sample);
+void write_log(Device *device);
+void *monitor_device(void *arg);
+void *writer_thread(void *arg);
+int run_replay(Device *devices, int device_count, const char *trace_path, int realtime,
+               const FaultConfig *faults);
+int open_gpio_cdev(Device *devices, int device_count, const char *spec, unsigned slot_us);
+int sync_mcu_clock(NetLink *link, const struct sockaddr_in *server_addr);
+void fetch_new_samples(NetLink *link, const struct sockaddr_in *server_addr, Device *devices, int device_count);
+void configure_mcu(NetLink *link, const struct sockaddr_in *server_addr, const char *settings);
+void print_link_report(const Device *devices, int device_count);
+// Make next the MCU the unicast commands go to, with its own clock fit and fetch cursors
+void switch_board(struct sockaddr_in *server_addr, const struct sockaddr_in *next, Device *devices, int device_count);
+void usage(const char *program);
+
+#endif /* GATEWAY_H */
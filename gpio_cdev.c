@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include "gpio_cdev.h"
+#include "rules.h"
+
+#define FRAME_BITS 4
+#define CDEV_EVENT_BATCH 16   // Edge events read per read() call
+#define CDEV_POLL_MS 10       // How long next() waits for edges before flushing
+#define CDEV_PENDING_MAX 8
+
+void frame_decoder_init(FrameDecoder *decoder, uint64_t slot_ns, int level) {
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->slot_ns = slot_ns;
+    decoder->level = level;
+}
+
+// Latch every bit whose sample point lies before until_ns at the current line level
+static int sample_bits(FrameDecoder *decoder, uint64_t until_ns, uint8_t *value, uint64_t *start_ns) {
+    if (!decoder->in_frame) {
+        return 0;
+    }
+    while (decoder->bit < FRAME_BITS &&
+           decoder->start_ns + decoder->slot_ns * decoder->bit + decoder->slot_ns / 2 < until_ns) {
+        if (decoder->level) {
+            decoder->value |= (uint8_t)(1u << decoder->bit);
+        }
+        decoder->bit++;
+    }
+    if (decoder->bit < FRAME_BITS) {
+        return 0;
+    }
+    decoder->in_frame = 0;
+    *value = decoder->value;
+    *start_ns = decoder->start_ns;
+    return 1;
+}
+
+int frame_decoder_edge(FrameDecoder *decoder, uint64_t ts_ns, int rising, uint8_t *value, uint64_t *start_ns) {
+    int done = sample_bits(decoder, ts_ns, value, start_ns);
+
+    decoder->level = rising;
+    if (!decoder->in_frame && !rising && ts_ns >= decoder->holdoff_ns) {
+        decoder->in_frame = 1;
+        decoder->start_ns = ts_ns;
+        decoder->holdoff_ns = ts_ns + decoder->slot_ns * FRAME_BITS;
+        decoder->bit = 0;
+        decoder->value = 0;
+    }
+    return done;
+}
+
+int frame_decoder_flush(FrameDecoder *decoder, uint64_t now_ns, uint8_t *value, uint64_t *start_ns) {
+    return sample_bits(decoder, now_ns, value, start_ns);
+}
+
+typedef struct {
+    int fd;               // Line request fd from GPIO_V2_GET_LINE_IOCTL
+    SensorId sensor;
+    uint32_t seq;
+    FrameDecoder decoder;
+    int hardware_clock;   // Events carry HTE timestamps instead of CLOCK_MONOTONIC
+    int64_t offset_ns;    // monotonic - event clock, smallest seen
+    int have_offset;
+    Sample pending[CDEV_PENDING_MAX];
+    int pending_count;
+} CdevSource;
+
+static uint64_t monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static void emit_frame(CdevSource *cdev, uint8_t value, uint64_t start_ns) {
+    if (cdev->pending_count == CDEV_PENDING_MAX) {
+        return;
+    }
+    Sample *sample = &cdev->pending[cdev->pending_count++];
+    sample->ts_ns = start_ns;
+    sample->seq = cdev->seq++;
+    sample->sensor = cdev->sensor;
+    sample->value = value;
+    sample->origin = ORIGIN_GPIO;
+}
+
+static int cdev_next(SensorSource *source, Sample *sample) {
+    CdevSource *cdev = source->priv;
+    struct gpio_v2_line_event events[CDEV_EVENT_BATCH];
+    struct pollfd pfd = {cdev->fd, POLLIN, 0};
+    uint8_t value;
+    uint64_t start_ns;
+
+    if (cdev->pending_count == 0) {
+        int ready = poll(&pfd, 1, CDEV_POLL_MS);
+        if (ready < 0 && errno != EINTR) {
+            return SOURCE_END;
+        }
+
+        if (ready > 0) {
+            ssize_t bytes = read(cdev->fd, events, sizeof(events));
+            if (bytes < 0) {
+                return errno == EAGAIN || errno == EINTR ? SOURCE_IDLE : SOURCE_END;
+            }
+            uint64_t now = monotonic_ns();
+            for (size_t i = 0; i < (size_t)bytes / sizeof(events[0]); i++) {
+                uint64_t ts = events[i].timestamp_ns;
+                if (cdev->hardware_clock) {
+                    // Map the HTE clock onto CLOCK_MONOTONIC, the smallest delay seen is the best estimate
+                    int64_t offset = (int64_t)(now - ts);
+                    if (!cdev->have_offset || offset < cdev->offset_ns) {
+                        cdev->offset_ns = offset;
+                        cdev->have_offset = 1;
+                    }
+                    ts += cdev->offset_ns;
+                }
+                if (frame_decoder_edge(&cdev->decoder, ts, events[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE,
+                                       &value, &start_ns)) {
+                    emit_frame(cdev, value, start_ns);
+                }
+            }
+        }
+        if (frame_decoder_flush(&cdev->decoder, monotonic_ns(), &value, &start_ns)) {
+            emit_frame(cdev, value, start_ns);
+        }
+        if (cdev->pending_count == 0) {
+            return SOURCE_IDLE;
+        }
+    }
+
+    *sample = cdev->pending[0];
+    memmove(cdev->pending, cdev->pending + 1, (cdev->pending_count - 1) * sizeof(Sample));
+    cdev->pending_count--;
+    return SOURCE_SAMPLE;
+}
+
+static void cdev_close(SensorSource *source) {
+    CdevSource *cdev = source->priv;
+    close(cdev->fd);
+    free(cdev);
+    free(source);
+}
+
+SensorSource *source_gpio_cdev_open(const char *chip_path, unsigned offset, SensorId sensor, unsigned slot_us) {
+    int chip_fd = open(chip_path, O_RDONLY | O_CLOEXEC);
+    if (chip_fd < 0) {
+        fprintf(stderr, "Error: Failed to open %s: %s\n", chip_path, strerror(errno));
+        return NULL;
+    }
+
+    struct gpio_v2_line_request request;
+    memset(&request, 0, sizeof(request));
+    request.offsets[0] = offset;
+    request.num_lines = 1;
+    request.event_buffer_size = CDEV_EVENT_BATCH * 4;
+    snprintf(request.consumer, sizeof(request.consumer), "gateway-%s", sensor_to_name(sensor));
+
+    // Prefer hardware timestamps, fall back to the kernel's CLOCK_MONOTONIC stamps
+    int hardware_clock = 1;
+    request.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING |
+                           GPIO_V2_LINE_FLAG_EDGE_FALLING | GPIO_V2_LINE_FLAG_EVENT_CLOCK_HTE;
+    if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &request) < 0) {
+        hardware_clock = 0;
+        request.config.flags &= ~(uint64_t)GPIO_V2_LINE_FLAG_EVENT_CLOCK_HTE;
+        if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &request) < 0) {
+            fprintf(stderr, "Error: Failed to request line %u on %s: %s\n", offset, chip_path, strerror(errno));
+            close(chip_fd);
+            return NULL;
+        }
+    }
+    close(chip_fd); // The line request fd stays valid on its own
+
+    // Events only report changes, so start from the level the line has now. It may be mid-frame.
+    struct gpio_v2_line_values values = {0, 1};
+    int level = 1; // Lines idle high between frames
+    if (ioctl(request.fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) == 0) {
+        level = (int)(values.bits & 1);
+    } else {
+        fprintf(stderr, "Warning: Failed to read line %u on %s, assuming idle high: %s\n", offset, chip_path,
+                strerror(errno));
+    }
+
+    SensorSource *source = calloc(1, sizeof(*source));
+    CdevSource *cdev = calloc(1, sizeof(*cdev));
+    if (!source || !cdev) {
+        close(request.fd);
+        free(source);
+        free(cdev);
+        return NULL;
+    }
+
+    cdev->fd = request.fd;
+    cdev->sensor = sensor;
+    cdev->hardware_clock = hardware_clock;
+    frame_decoder_init(&cdev->decoder, (uint64_t)slot_us * 1000ull, level);
+    source->next = cdev_next;
+    source->close = cdev_close;
+    source->priv = cdev;
+    return source;
+}
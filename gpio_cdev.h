@@ -0,0 +1,38 @@
+#ifndef GPIO_CDEV_H
+#define GPIO_CDEV_H
+
+#include <stdint.h>
+#include "source.h"
+
+/*
+ * Sensor ingestion straight from the GPIO character device, without the
+ * gpio_class_* kernel modules. Each sensor line is requested with rising
+ * and falling edge detection and its timestamped edge events are read in
+ * batches. Frames are rebuilt from the edge times: the MCU pulls the line
+ * low to start a frame and then holds each of the 4 bits (LSB first) for
+ * one time slot, so bit k is the line level at start + (k + 0.5) slots.
+ *
+ * Without hardware, the same path runs against gpio-sim: create a bank
+ * through configfs (/sys/kernel/config/gpio-sim), then drive a line by
+ * writing "pull-up"/"pull-down" to its sim_gpioN/pull attribute.
+ */
+
+typedef struct {
+    uint64_t slot_ns;     // Length of one bit slot
+    uint64_t start_ns;    // Falling edge that opened the current frame
+    uint64_t holdoff_ns;  // No new frame may start before this time
+    int in_frame;
+    int level;            // Line level after the last edge
+    int bit;              // Next bit to sample
+    uint8_t value;
+} FrameDecoder;
+
+void frame_decoder_init(FrameDecoder *decoder, uint64_t slot_ns, int level); // level: the line's level right now
+// Apply one edge. Returns 1 and sets *value/*start_ns when the edge completes a frame.
+int frame_decoder_edge(FrameDecoder *decoder, uint64_t ts_ns, int rising, uint8_t *value, uint64_t *start_ns);
+// Finish a frame whose last sample point has passed without another edge.
+int frame_decoder_flush(FrameDecoder *decoder, uint64_t now_ns, uint8_t *value, uint64_t *start_ns);
+
+SensorSource *source_gpio_cdev_open(const char *chip_path, unsigned offset, SensorId sensor, unsigned slot_us);
+
+#endif /* GPIO_CDEV_H */
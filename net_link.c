@@ -0,0 +1,281 @@
+#define _GNU_SOURCE // recvmmsg(), sendmmsg()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "net_link.h"
+
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL 46
+#endif
+
+#define NET_CONTROL_LEN 64 // Room for the timestamp and drop counter cmsgs
+
+struct NetVectors {
+    struct mmsghdr rx_msgs[NET_BATCH];
+    struct iovec rx_iov[NET_BATCH];
+    struct sockaddr_in rx_from[NET_BATCH];
+    uint64_t rx_ns[NET_BATCH];
+    uint8_t rx_control[NET_BATCH][NET_CONTROL_LEN];
+    uint8_t rx_buf[NET_BATCH][NET_DATAGRAM_MAX];
+    int rx_count;               // Datagrams in the current batch
+    int rx_next;                // Next one net_recv() hands out
+    struct mmsghdr tx_msgs[NET_BATCH];
+    struct iovec tx_iov[NET_BATCH];
+    struct sockaddr_in tx_to[NET_BATCH];
+    uint8_t tx_buf[NET_BATCH][NET_DATAGRAM_MAX];
+    int tx_count;
+};
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static int batch_bucket(int count) {
+    int bucket = 0;
+    while (count > 1 && bucket < NET_BATCH_BUCKETS - 1) {
+        count >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+int net_open(NetLink *link, const NetConfig *config) {
+    int on = 1;
+    socklen_t size = sizeof(int);
+
+    memset(link, 0, sizeof(*link));
+    link->vectors = calloc(1, sizeof(NetVectors));
+    link->fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (link->fd < 0 || !link->vectors) {
+        net_close(link);
+        return -1;
+    }
+    if (setsockopt(link->fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0 ||
+        setsockopt(link->fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) < 0) {
+        fprintf(stderr, "Warning: No receive timestamps or drop counts: %s\n", strerror(errno));
+    }
+    // Above net.core.rmem_max only the privileged variant gets the full size
+    if (config->rcvbuf > 0 &&
+        setsockopt(link->fd, SOL_SOCKET, SO_RCVBUFFORCE, &config->rcvbuf, sizeof(config->rcvbuf)) < 0) {
+        setsockopt(link->fd, SOL_SOCKET, SO_RCVBUF, &config->rcvbuf, sizeof(config->rcvbuf));
+    }
+    getsockopt(link->fd, SOL_SOCKET, SO_RCVBUF, &link->rcvbuf, &size);
+    if (config->busy_poll_us > 0) {
+        if (setsockopt(link->fd, SOL_SOCKET, SO_BUSY_POLL, &config->busy_poll_us, sizeof(config->busy_poll_us)) < 0) {
+            fprintf(stderr, "Warning: SO_BUSY_POLL %d us refused: %s\n", config->busy_poll_us, strerror(errno));
+        } else {
+            link->busy_poll_us = config->busy_poll_us;
+        }
+    }
+
+    NetVectors *v = link->vectors;
+    for (int i = 0; i < NET_BATCH; i++) {
+        v->rx_iov[i] = (struct iovec){v->rx_buf[i], NET_DATAGRAM_MAX};
+        v->tx_iov[i] = (struct iovec){v->tx_buf[i], 0};
+        v->tx_msgs[i].msg_hdr.msg_iov = &v->tx_iov[i];
+        v->tx_msgs[i].msg_hdr.msg_iovlen = 1;
+        v->tx_msgs[i].msg_hdr.msg_name = &v->tx_to[i];
+        v->tx_msgs[i].msg_hdr.msg_namelen = sizeof(v->tx_to[i]);
+    }
+    return 0;
+}
+
+void net_close(NetLink *link) {
+    if (link->fd >= 0) {
+        close(link->fd);
+    }
+    free(link->vectors);
+    link->vectors = NULL;
+    link->fd = -1;
+}
+
+// recvmmsg() overwrites the lengths, so every header is reset before each call
+static void rx_prepare(NetVectors *v) {
+    for (int i = 0; i < NET_BATCH; i++) {
+        struct msghdr *header = &v->rx_msgs[i].msg_hdr;
+        header->msg_iov = &v->rx_iov[i];
+        header->msg_iovlen = 1;
+        header->msg_name = &v->rx_from[i];
+        header->msg_namelen = sizeof(v->rx_from[i]);
+        header->msg_control = v->rx_control[i];
+        header->msg_controllen = NET_CONTROL_LEN;
+        header->msg_flags = 0;
+    }
+}
+
+// Kernel timestamps and drop counts of a fresh batch. The timestamps are CLOCK_REALTIME,
+// the offset to CLOCK_MONOTONIC is taken once per batch.
+static void rx_annotate(NetLink *link, int count) {
+    uint64_t mono = clock_ns(CLOCK_MONOTONIC);
+    int64_t offset = (int64_t)(clock_ns(CLOCK_REALTIME) - mono);
+    NetVectors *v = link->vectors;
+
+    for (int i = 0; i < count; i++) {
+        struct msghdr *header = &v->rx_msgs[i].msg_hdr;
+        v->rx_ns[i] = 0;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(header); cmsg; cmsg = CMSG_NXTHDR(header, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET) {
+                continue;
+            }
+            if (cmsg->cmsg_type == SO_TIMESTAMPNS) {
+                struct timespec ts;
+                memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                v->rx_ns[i] = (uint64_t)((int64_t)((uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec) - offset);
+            } else if (cmsg->cmsg_type == SO_RXQ_OVFL) {
+                uint32_t drops;
+                memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+                link->stats.kernel_drops = drops;
+            }
+        }
+        // A timestamp from before a clock step could land in the future, trust the syscall then
+        if (v->rx_ns[i] == 0 || v->rx_ns[i] > mono) {
+            v->rx_ns[i] = mono;
+            link->stats.rx_untimed++;
+        }
+        if (header->msg_flags & MSG_TRUNC) {
+            link->stats.rx_truncated++;
+        }
+        link->stats.rx_bytes += v->rx_msgs[i].msg_len;
+    }
+    link->stats.rx_calls++;
+    link->stats.rx_datagrams += count;
+    link->stats.rx_batches[batch_bucket(count)]++;
+}
+
+// One recvmmsg() for whatever is queued, poll() only when the socket is empty
+static int rx_fill(NetLink *link, int timeout_ms) {
+    uint64_t deadline = clock_ns(CLOCK_MONOTONIC) + (uint64_t)timeout_ms * 1000000ull;
+    NetVectors *v = link->vectors;
+
+    for (;;) {
+        rx_prepare(v);
+        int count = recvmmsg(link->fd, v->rx_msgs, NET_BATCH, MSG_DONTWAIT, NULL);
+        if (count > 0) {
+            rx_annotate(link, count);
+            v->rx_count = count;
+            v->rx_next = 0;
+            return count;
+        }
+        if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            return -1;
+        }
+
+        uint64_t now = clock_ns(CLOCK_MONOTONIC);
+        if (now >= deadline) {
+            return 0;
+        }
+        struct pollfd pfd = {link->fd, POLLIN, 0};
+        int wait_ms = (int)((deadline - now + 999999) / 1000000);
+        if (poll(&pfd, 1, wait_ms) < 0 && errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+int net_recv(NetLink *link, NetDatagram *datagram, int timeout_ms) {
+    NetVectors *v = link->vectors;
+
+    if (v->rx_next == v->rx_count) {
+        int count = rx_fill(link, timeout_ms);
+        if (count <= 0) {
+            return count;
+        }
+    }
+
+    int i = v->rx_next++;
+    datagram->data = v->rx_buf[i];
+    datagram->len = v->rx_msgs[i].msg_len < NET_DATAGRAM_MAX ? v->rx_msgs[i].msg_len : NET_DATAGRAM_MAX;
+    datagram->rx_ns = v->rx_ns[i];
+    datagram->from = v->rx_from[i];
+    return 1;
+}
+
+int net_queue(NetLink *link, const struct sockaddr_in *to, const void *data, size_t len) {
+    NetVectors *v = link->vectors;
+
+    if (len > NET_DATAGRAM_MAX) {
+        return -1;
+    }
+    if (v->tx_count == NET_BATCH) {
+        net_flush(link);
+    }
+    int i = v->tx_count++;
+    memcpy(v->tx_buf[i], data, len);
+    v->tx_iov[i].iov_len = len;
+    v->tx_to[i] = *to;
+    return 0;
+}
+
+int net_flush(NetLink *link) {
+    NetVectors *v = link->vectors;
+    int sent = 0, delivered = 0;
+
+    while (sent < v->tx_count) {
+        int count = sendmmsg(link->fd, v->tx_msgs + sent, v->tx_count - sent, 0);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Skip the datagram the kernel refused, the rest may still go out
+            link->stats.tx_errors++;
+            sent++;
+            continue;
+        }
+        link->stats.tx_calls++;
+        link->stats.tx_datagrams += count;
+        link->stats.tx_batches[batch_bucket(count)]++;
+        sent += count;
+        delivered += count;
+    }
+    int queued = v->tx_count;
+    v->tx_count = 0;
+    return queued && !delivered ? -1 : delivered;
+}
+
+int net_send(NetLink *link, const struct sockaddr_in *to, const void *data, size_t len) {
+    if (net_queue(link, to, data, len) < 0) {
+        return -1;
+    }
+    return net_flush(link);
+}
+
+int net_multicast(NetLink *link, struct in_addr interface, int ttl) {
+    unsigned char hops = (unsigned char)ttl, loop = 1;
+
+    if (interface.s_addr != htonl(INADDR_ANY) &&
+        setsockopt(link->fd, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface)) < 0) {
+        return -1;
+    }
+    if (setsockopt(link->fd, IPPROTO_IP, IP_MULTICAST_TTL, &hops, sizeof(hops)) < 0 ||
+        setsockopt(link->fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+void net_print_stats(const NetLink *link) {
+    const NetStats *stats = &link->stats;
+    static const char *buckets[NET_BATCH_BUCKETS] = {"1", "2-3", "4-7", "8-15", "16-31", "32"};
+
+    printf("Socket: rcvbuf %d bytes, busy poll %d us\n", link->rcvbuf, link->busy_poll_us);
+    printf("RX: %lu datagrams, %lu bytes in %lu recvmmsg calls (%.2f per call), %lu kernel drops, "
+           "%lu truncated, %lu without kernel timestamp\n",
+           stats->rx_datagrams, stats->rx_bytes, stats->rx_calls,
+           stats->rx_calls ? (double)stats->rx_datagrams / stats->rx_calls : 0.0, stats->kernel_drops,
+           stats->rx_truncated, stats->rx_untimed);
+    printf("TX: %lu datagrams in %lu sendmmsg calls (%.2f per call), %lu errors\n",
+           stats->tx_datagrams, stats->tx_calls,
+           stats->tx_calls ? (double)stats->tx_datagrams / stats->tx_calls : 0.0, stats->tx_errors);
+    printf("Batch sizes (RX/TX):");
+    for (int i = 0; i < NET_BATCH_BUCKETS; i++) {
+        printf(" %s: %lu/%lu", buckets[i], stats->rx_batches[i], stats->tx_batches[i]);
+    }
+    printf("\n");
+}
@@ -0,0 +1,74 @@
+#ifndef NET_LINK_H
+#define NET_LINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <netinet/in.h>
+
+/*
+ * The gateway's UDP socket to the MCUs. Datagrams move in batches: one
+ * recvmmsg() fills up to NET_BATCH preallocated buffers and net_recv()
+ * hands them out one by one, net_queue() collects outgoing datagrams for a
+ * single sendmmsg() in net_flush().
+ *
+ * Every received datagram carries the kernel's receive time (SO_TIMESTAMPNS),
+ * mapped from CLOCK_REALTIME onto CLOCK_MONOTONIC, so arrival times do not
+ * include the time spent waiting in the socket or in the menu. The kernel's
+ * count of datagrams dropped on a full receive buffer (SO_RXQ_OVFL) arrives
+ * with them.
+ */
+
+#define NET_BATCH 32            // Datagrams per recvmmsg() / sendmmsg()
+#define NET_DATAGRAM_MAX 1472   // Ethernet MTU minus IP and UDP headers
+#define NET_BATCH_BUCKETS 6     // log2 batch size histogram: 1, 2-3, 4-7, 8-15, 16-31, 32
+
+typedef struct {
+    int rcvbuf;                 // SO_RCVBUF bytes, 0 keeps the system default
+    int busy_poll_us;           // SO_BUSY_POLL, 0 leaves it off
+} NetConfig;
+
+typedef struct {
+    unsigned long rx_calls;     // recvmmsg() calls that returned datagrams
+    unsigned long rx_datagrams;
+    unsigned long rx_bytes;
+    unsigned long rx_batches[NET_BATCH_BUCKETS];
+    unsigned long rx_truncated; // Larger than NET_DATAGRAM_MAX, handed out cut short
+    unsigned long rx_untimed;   // No kernel timestamp, stamped after the syscall instead
+    unsigned long kernel_drops; // SO_RXQ_OVFL, the latest cumulative count
+    unsigned long tx_calls;
+    unsigned long tx_datagrams;
+    unsigned long tx_batches[NET_BATCH_BUCKETS];
+    unsigned long tx_errors;    // Datagrams sendmmsg() refused
+} NetStats;
+
+typedef struct {
+    const uint8_t *data;        // Valid until net_recv() has to fetch a new batch
+    size_t len;
+    uint64_t rx_ns;             // Kernel receive time on CLOCK_MONOTONIC
+    struct sockaddr_in from;
+} NetDatagram;
+
+typedef struct NetVectors NetVectors; // The preallocated mmsghdr/iovec/buffer arrays, net_link.c only
+
+typedef struct {
+    int fd;
+    int rcvbuf;                 // Effective size, as the kernel reports it
+    int busy_poll_us;           // Effective, 0 if the kernel refused it
+    NetVectors *vectors;
+    NetStats stats;
+} NetLink;
+
+int net_open(NetLink *link, const NetConfig *config);
+void net_close(NetLink *link);
+// Next datagram: 1 with *datagram set, 0 if none arrived within timeout_ms, -1 on error
+int net_recv(NetLink *link, NetDatagram *datagram, int timeout_ms);
+// Add a datagram to the send batch, a full batch is flushed first. Returns -1 if len is too large.
+int net_queue(NetLink *link, const struct sockaddr_in *to, const void *data, size_t len);
+int net_flush(NetLink *link); // Datagrams sent, -1 if none of the queued ones could be
+int net_send(NetLink *link, const struct sockaddr_in *to, const void *data, size_t len); // queue + flush
+void net_print_stats(const NetLink *link);
+// Datagrams to multicast groups leave through interface (INADDR_ANY: the routing table's choice)
+// with the given TTL, and are looped back to members on this host
+int net_multicast(NetLink *link, struct in_addr interface, int ttl);
+
+#endif /* NET_LINK_H */
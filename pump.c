@@ -7,20 +7,62 @@
 #include <linux/of.h>
 #include <linux/of_gpio.h>
 #include <linux/platform_device.h>
+#include <linux/device.h>
+#include <linux/ktime.h>
+#include <linux/spinlock.h>
+#include <linux/sysfs.h>
+#include "pump_telemetry.h"
 
-#define GPIO_BUTTON 72   // GPIO pin for the button
-#define DEBOUNCE_DELAY 50 // Debounce delay in milliseconds
+#define GPIO_BUTTON 72   // Default GPIO pin for the button, DT "button-pin"
+#define DEBOUNCE_DELAY 50 // Default debounce delay in milliseconds, DT "debounce-ms"
+#define DEBOUNCE_MAX 10000
 
 static struct timer_list debounce_timer;
 static unsigned long last_irq_time = 0;
 static int toggle_state = 0;
 static int gpio_toggle = -1;
+static int gpio_button = GPIO_BUTTON;
+static unsigned int debounce_ms = DEBOUNCE_DELAY; // Adjustable live through sysfs
 static int irq_number;
+static struct class *pump_class = NULL;
+static struct device *pump_device = NULL;
+static DEFINE_SPINLOCK(pump_lock);   // Serializes button timer and sysfs writers
+static ktime_t on_since;             // When the pump was last switched on
+static u64 total_on_ns = 0;          // Cumulative ON time over completed cycles
+static u64 last_on_ns = 0;           // Duration of the last completed ON cycle
+static u32 on_cycles = 0;            // Number of OFF->ON transitions
+static u32 on_hist[PUMP_HIST_BUCKETS]; // Completed ON cycles by log2 of their length in ms
+static ktime_t stats_since;          // Start of the accounting period (probe time)
 
-static void toggle_gpio(void)
+// Drive the pump output and update the ON-time accounting. Caller holds pump_lock.
+static void set_pump_locked(int state)
 {
-    toggle_state = !toggle_state;
+    ktime_t now;
+
+    state = !!state;
+    if (state == toggle_state)
+        return;
+
+    now = ktime_get();
+    if (state) {
+        on_since = now;
+        on_cycles++;
+    } else {
+        last_on_ns = ktime_to_ns(ktime_sub(now, on_since));
+        total_on_ns += last_on_ns;
+        on_hist[min_t(unsigned int, fls64(div_u64(last_on_ns, NSEC_PER_MSEC)), PUMP_HIST_BUCKETS - 1)]++;
+    }
+    toggle_state = state;
     gpio_set_value(gpio_toggle, toggle_state);
+}
+
+static void toggle_gpio(void)
+{
+    unsigned long flags;
+
+    spin_lock_irqsave(&pump_lock, flags);
+    set_pump_locked(!toggle_state);
+    spin_unlock_irqrestore(&pump_lock, flags);
     printk(KERN_INFO "GPIO %d toggled to %d\n", gpio_toggle, toggle_state);
 }
 
@@ -29,7 +71,7 @@ static void debounce_func(struct timer_list *t)
     unsigned long current_time = jiffies;
 
     // Check if enough time has passed to consider the interrupt valid
-    if (time_after(current_time, last_irq_time + msecs_to_jiffies(DEBOUNCE_DELAY))) {
+    if (time_after(current_time, last_irq_time + msecs_to_jiffies(READ_ONCE(debounce_ms)))) {
         toggle_gpio();
     }
 }
@@ -37,59 +79,239 @@ static void debounce_func(struct timer_list *t)
 static irqreturn_t gpio_irq_handler(int irq, void *dev_id)
 {
     last_irq_time = jiffies; // Update the last interrupt time
-    mod_timer(&debounce_timer, jiffies + msecs_to_jiffies(DEBOUNCE_DELAY));
+    mod_timer(&debounce_timer, jiffies + msecs_to_jiffies(READ_ONCE(debounce_ms)));
     return IRQ_HANDLED; // Indicate that the interrupt has been handled
 }
 
+static ssize_t state_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%d\n", toggle_state);
+}
+
+static ssize_t state_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    unsigned long flags;
+
+    if (buf[0] != '0' && buf[0] != '1')
+        return -EINVAL;
+
+    spin_lock_irqsave(&pump_lock, flags);
+    set_pump_locked(buf[0] == '1');
+    spin_unlock_irqrestore(&pump_lock, flags);
+    return count;
+}
+
+// "<on_time_us> <last_on_us> <total_on_us> <cycles>", on_time_us is 0 while OFF
+static ssize_t stats_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    unsigned long flags;
+    u64 current_ns = 0, last_ns, total_ns;
+    u32 cycles;
+
+    spin_lock_irqsave(&pump_lock, flags);
+    if (toggle_state)
+        current_ns = ktime_to_ns(ktime_sub(ktime_get(), on_since));
+    last_ns = last_on_ns;
+    total_ns = total_on_ns + current_ns;
+    cycles = on_cycles;
+    spin_unlock_irqrestore(&pump_lock, flags);
+
+    return sprintf(buf, "%llu %llu %llu %u\n", div_u64(current_ns, NSEC_PER_USEC),
+                   div_u64(last_ns, NSEC_PER_USEC), div_u64(total_ns, NSEC_PER_USEC), cycles);
+}
+
+// Same counters plus the ON-time histogram as one struct pump_telemetry record
+static ssize_t telemetry_read(struct file *filp, struct kobject *kobj, struct bin_attribute *attr,
+                              char *buf, loff_t off, size_t count)
+{
+    struct pump_telemetry record;
+    unsigned long flags;
+    ktime_t now;
+    u64 current_ns = 0;
+    int i;
+
+    if (off >= sizeof(record))
+        return 0;
+
+    memset(&record, 0, sizeof(record));
+    record.tag[0] = 'P';
+    record.tag[1] = 'T';
+    record.version = PUMP_TELEMETRY_VERSION;
+
+    spin_lock_irqsave(&pump_lock, flags);
+    now = ktime_get();
+    if (toggle_state)
+        current_ns = ktime_to_ns(ktime_sub(now, on_since));
+    record.state = toggle_state;
+    record.cycles = cpu_to_le32(on_cycles);
+    record.uptime_us = cpu_to_le64(div_u64(ktime_to_ns(ktime_sub(now, stats_since)), NSEC_PER_USEC));
+    record.total_on_us = cpu_to_le64(div_u64(total_on_ns + current_ns, NSEC_PER_USEC));
+    record.current_on_us = cpu_to_le64(div_u64(current_ns, NSEC_PER_USEC));
+    record.last_on_us = cpu_to_le64(div_u64(last_on_ns, NSEC_PER_USEC));
+    for (i = 0; i < PUMP_HIST_BUCKETS; i++)
+        record.histogram[i] = cpu_to_le32(on_hist[i]);
+    spin_unlock_irqrestore(&pump_lock, flags);
+
+    if (count > sizeof(record) - off)
+        count = sizeof(record) - off;
+    memcpy(buf, (char *)&record + off, count);
+    return count;
+}
+
+static ssize_t debounce_ms_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%u\n", READ_ONCE(debounce_ms));
+}
+
+static ssize_t debounce_ms_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    unsigned int ms;
+    int result = kstrtouint(buf, 10, &ms);
+
+    if (result)
+        return result;
+    if (ms > DEBOUNCE_MAX)
+        return -EINVAL;
+    WRITE_ONCE(debounce_ms, ms);
+    return count;
+}
+
+static DEVICE_ATTR(state, 0644, state_show, state_store);
+static DEVICE_ATTR(debounce_ms, 0644, debounce_ms_show, debounce_ms_store);
+static DEVICE_ATTR(stats, 0444, stats_show, NULL);
+static BIN_ATTR_RO(telemetry, sizeof(struct pump_telemetry));
+
 static int gpio_toggle_probe(struct platform_device *pdev)
 {
     int result;
     struct device_node *np = pdev->dev.of_node;
+    const char *device_name;
+    const char *class_name;
+    u32 pin; // of_property_read_u32() wants a u32, the GPIO numbers are ints
 
     // Read the GPIO pin from the device tree
-    if (of_property_read_u32(np, "pin", &gpio_toggle)) {
+    if (of_property_read_u32(np, "pin", &pin)) {
         printk(KERN_ERR "Failed to read GPIO pin from device tree\n");
         return -EINVAL;
     }
+    gpio_toggle = pin;
+
+    if (of_property_read_string(np, "device-name", &device_name) ||
+        of_property_read_string(np, "class-name", &class_name)) {
+        printk(KERN_ERR "Failed to read device/class name from device tree\n");
+        return -EINVAL;
+    }
+
+    // Optional, the defaults apply when a property is missing
+    pin = GPIO_BUTTON;
+    debounce_ms = DEBOUNCE_DELAY;
+    of_property_read_u32(np, "button-pin", &pin);
+    of_property_read_u32(np, "debounce-ms", &debounce_ms);
+    gpio_button = pin;
+    if (debounce_ms > DEBOUNCE_MAX) {
+        printk(KERN_ERR "Invalid debounce-ms %u in device tree\n", debounce_ms);
+        return -EINVAL;
+    }
 
 
     // Request GPIOs
-    if (!gpio_is_valid(GPIO_BUTTON) || !gpio_is_valid(gpio_toggle)) {
+    if (!gpio_is_valid(gpio_button) || !gpio_is_valid(gpio_toggle)) {
         printk(KERN_ERR "Invalid GPIOs\n");
         return -ENODEV;
     }
 
     // Set GPIO for the button as input
-    gpio_request(GPIO_BUTTON, "GPIO_BUTTON");
-    gpio_direction_input(GPIO_BUTTON);
+    gpio_request(gpio_button, "GPIO_BUTTON");
+    gpio_direction_input(gpio_button);
 
     // Set GPIO for toggle as output
     gpio_request(gpio_toggle, "GPIO_TOGGLE");
     gpio_direction_output(gpio_toggle, 0); // Initialize to low
 
-    // Request IRQ for GPIO_BUTTON
-    irq_number = gpio_to_irq(GPIO_BUTTON);
-    printk(KERN_INFO "Probed BUTTON, GPIO pin %d assigned to IRQ %d\n", GPIO_BUTTON, irq_number);
+    // The IRQ handler arms the timer, so it must exist first
+    timer_setup(&debounce_timer, debounce_func, 0);
+    stats_since = ktime_get();
+
+    // Request IRQ for the button
+    irq_number = gpio_to_irq(gpio_button);
+    printk(KERN_INFO "Probed BUTTON, GPIO pin %d assigned to IRQ %d\n", gpio_button, irq_number);
     result = request_irq(irq_number, gpio_irq_handler, IRQF_TRIGGER_RISING, "gpio_irq_handler", NULL);
     if (result) {
         printk(KERN_ERR "Failed to request IRQ: %d\n", result);
-        gpio_free(GPIO_BUTTON);
+        gpio_free(gpio_button);
         gpio_free(gpio_toggle);
         return result;
     }
 
-    // Initialize timer
-    timer_setup(&debounce_timer, debounce_func, 0);
-    
-    
+    // Expose pump state and ON-time counters to user space
+    pump_class = class_create(THIS_MODULE, class_name);
+    if (IS_ERR(pump_class)) {
+        result = PTR_ERR(pump_class);
+        goto err_irq;
+    }
+
+    pump_device = device_create(pump_class, NULL, 0, NULL, device_name);
+    if (IS_ERR(pump_device)) {
+        result = PTR_ERR(pump_device);
+        goto err_class;
+    }
+
+    result = device_create_file(pump_device, &dev_attr_state);
+    if (result)
+        goto err_device;
+
+    result = device_create_file(pump_device, &dev_attr_stats);
+    if (result)
+        goto err_state;
+
+    result = device_create_bin_file(pump_device, &bin_attr_telemetry);
+    if (result)
+        goto err_stats;
+
+    result = device_create_file(pump_device, &dev_attr_debounce_ms);
+    if (result)
+        goto err_telemetry;
+
     return 0; // Module loaded successfully
+
+err_telemetry:
+    device_remove_bin_file(pump_device, &bin_attr_telemetry);
+err_stats:
+    device_remove_file(pump_device, &dev_attr_stats);
+err_state:
+    device_remove_file(pump_device, &dev_attr_state);
+err_device:
+    device_destroy(pump_class, 0);
+err_class:
+    class_destroy(pump_class);
+err_irq:
+    printk(KERN_ERR "Failed to create pump sysfs interface: %d\n", result);
+    free_irq(irq_number, NULL);
+    del_timer_sync(&debounce_timer); // After the IRQ is gone nothing can re-arm it
+    gpio_free(gpio_button);
+    gpio_free(gpio_toggle);
+    return result;
 }
 
 static int gpio_toggle_remove(struct platform_device *pdev)
 {
-    del_timer(&debounce_timer); // Delete timer
-    free_irq(gpio_to_irq(GPIO_BUTTON), NULL); // Free IRQ
-    gpio_free(GPIO_BUTTON); // Free GPIOs
+    unsigned long flags;
+
+    device_remove_file(pump_device, &dev_attr_debounce_ms);
+    device_remove_bin_file(pump_device, &bin_attr_telemetry);
+    device_remove_file(pump_device, &dev_attr_stats);
+    device_remove_file(pump_device, &dev_attr_state);
+    device_destroy(pump_class, 0);
+    class_destroy(pump_class);
+    free_irq(gpio_to_irq(gpio_button), NULL); // Free IRQ
+    del_timer_sync(&debounce_timer); // Delete timer, the IRQ can no longer re-arm it
+
+    // Leave the pump off, nothing can switch it anymore once the driver is gone
+    spin_lock_irqsave(&pump_lock, flags);
+    set_pump_locked(0);
+    spin_unlock_irqrestore(&pump_lock, flags);
+
+    gpio_free(gpio_button); // Free GPIOs
     gpio_free(gpio_toggle);
     printk(KERN_INFO "GPIO Toggle Module Exited\n");
     return 0;
@@ -0,0 +1,36 @@
+#ifndef PUMP_TELEMETRY_H
+#define PUMP_TELEMETRY_H
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+#endif
+
+/*
+ * Binary pump telemetry, served by pump.c through the "telemetry" sysfs
+ * attribute and by the MCU for the "pump_telemetry" UDP command (the
+ * firmware keeps the same layout in RTG/Inc/pump_telemetry.h).
+ * Little endian, no padding.
+ *
+ * histogram[i] counts completed ON cycles lasting [2^(i-1), 2^i) ms,
+ * bucket 0 is under 1 ms and the last bucket is open ended.
+ * Duty cycle is total_on_us / uptime_us.
+ */
+
+#define PUMP_TELEMETRY_VERSION 1
+#define PUMP_HIST_BUCKETS 16
+
+struct pump_telemetry {
+    char tag[2];           // "PT"
+    uint8_t version;
+    uint8_t state;         // 1 while the pump is ON
+    uint32_t cycles;       // OFF->ON transitions
+    uint64_t uptime_us;    // Time covered by the counters
+    uint64_t total_on_us;  // Including the running cycle
+    uint64_t current_on_us; // 0 while OFF
+    uint64_t last_on_us;   // Last completed cycle
+    uint32_t histogram[PUMP_HIST_BUCKETS];
+} __attribute__((packed));
+
+#endif /* PUMP_TELEMETRY_H */
@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rules.h"
+
+static const char *sensor_names[SENSOR_COUNT] = {"humidity", "saltiness", "light"};
+static const char *action_names[] = {"pump_on", "pump_off", "pump_toggle", "alert"};
+
+int sensor_from_name(const char *name) {
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        if (strcmp(name, sensor_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const char *sensor_to_name(int sensor) {
+    return (sensor >= 0 && sensor < SENSOR_COUNT) ? sensor_names[sensor] : "unknown";
+}
+
+const char *rules_action_name(int action) {
+    size_t count = sizeof(action_names) / sizeof(action_names[0]);
+    return (action >= 0 && (size_t)action < count) ? action_names[action] : "unknown";
+}
+
+void rules_init(RuleEngine *engine, RuleActionFn action, void *ctx) {
+    memset(engine, 0, sizeof(*engine));
+    engine->action = action;
+    engine->ctx = ctx;
+}
+
+// Parse "<sensor> <op> <value> [hyst <n>]" or "<sensor> rate <op> <value>" starting at tokens[0]
+static int parse_term(char **tokens, int count, RuleTerm *term, int *used) {
+    int pos = 0;
+    int rate = 0;
+
+    if (count < 3) {
+        return -1;
+    }
+    int sensor = sensor_from_name(tokens[pos++]);
+    if (sensor < 0) {
+        return -1;
+    }
+    if (strcmp(tokens[pos], "rate") == 0) {
+        rate = 1;
+        pos++;
+        if (count < 4) {
+            return -1;
+        }
+    }
+
+    const char *op = tokens[pos++];
+    char *end;
+    term->threshold = strtof(tokens[pos++], &end);
+    if (*end != '\0') {
+        return -1;
+    }
+    if (strcmp(op, "<") == 0) {
+        term->kind = rate ? TERM_RATE_BELOW : TERM_BELOW;
+    } else if (strcmp(op, ">") == 0) {
+        term->kind = rate ? TERM_RATE_ABOVE : TERM_ABOVE;
+    } else {
+        return -1;
+    }
+
+    term->hysteresis = 0;
+    if (!rate && pos + 1 < count && strcmp(tokens[pos], "hyst") == 0) {
+        term->hysteresis = strtof(tokens[pos + 1], &end);
+        if (*end != '\0' || term->hysteresis < 0) {
+            return -1;
+        }
+        pos += 2;
+    }
+
+    term->sensor = (uint8_t)sensor;
+    atomic_init(&term->state, 0);
+    *used = pos;
+    return 0;
+}
+
+static int parse_rule(RuleEngine *engine, char *line, RuleTerm *terms, int *term_count) {
+    char *tokens[32];
+    int count = 0;
+    char *save;
+
+    for (char *tok = strtok_r(line, " \t\r\n", &save); tok && count < 32; tok = strtok_r(NULL, " \t\r\n", &save)) {
+        tokens[count++] = tok;
+    }
+    if (count == 0) {
+        return 0; // Blank line
+    }
+    if (engine->rule_count == RULES_MAX || count < 5) {
+        return -1;
+    }
+
+    Rule *rule = &engine->rules[engine->rule_count];
+    memset(rule, 0, sizeof(*rule));
+    snprintf(rule->name, sizeof(rule->name), "%s", tokens[0]);
+    rule->term_first = (uint16_t)*term_count;
+
+    int pos = 1;
+    int joiner = -1; // Unknown until the first "and"/"or"
+    while (1) {
+        int used;
+        if (rule->term_count == RULE_TERMS_MAX ||
+            parse_term(tokens + pos, count - pos, &terms[*term_count], &used) < 0) {
+            return -1;
+        }
+        terms[*term_count].rule = (uint16_t)engine->rule_count;
+        (*term_count)++;
+        rule->term_count++;
+        pos += used;
+
+        if (pos < count && (strcmp(tokens[pos], "and") == 0 || strcmp(tokens[pos], "or") == 0)) {
+            int any = tokens[pos][0] == 'o';
+            if (joiner >= 0 && joiner != any) {
+                return -1; // Mixed and/or
+            }
+            joiner = any;
+            pos++;
+            continue;
+        }
+        break;
+    }
+    rule->any = joiner == 1;
+
+    if (pos + 2 != count || strcmp(tokens[pos], "->") != 0) {
+        return -1;
+    }
+    size_t action_count = sizeof(action_names) / sizeof(action_names[0]);
+    for (size_t i = 0; i < action_count; i++) {
+        if (strcmp(tokens[pos + 1], action_names[i]) == 0) {
+            rule->action = (uint8_t)i;
+            engine->rule_count++;
+            return 1;
+        }
+    }
+    return -1;
+}
+
+int rules_compile(RuleEngine *engine, const char *text) {
+    char *copy = strdup(text);
+    char *save;
+    int line_number = 0;
+    int term_count = 0;
+
+    if (!copy) {
+        return -1;
+    }
+    engine->rule_count = 0;
+    for (char *line = strtok_r(copy, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        line_number++;
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+        if (parse_rule(engine, line, engine->terms, &term_count) < 0) {
+            fprintf(stderr, "Error: invalid rule on line %d\n", line_number);
+            free(copy);
+            engine->rule_count = 0;
+            engine->term_count = 0;
+            return -1;
+        }
+    }
+    free(copy);
+    engine->term_count = term_count;
+
+    // Group term indexes by sensor so evaluation only visits relevant terms
+    int fill = 0;
+    for (int s = 0; s < SENSOR_COUNT; s++) {
+        engine->sensor_first[s] = (uint16_t)fill;
+        for (int t = 0; t < term_count; t++) {
+            if (engine->terms[t].sensor == s) {
+                engine->by_sensor[fill++] = (uint16_t)t;
+            }
+        }
+    }
+    engine->sensor_first[SENSOR_COUNT] = (uint16_t)fill;
+    memset(engine->last, 0, sizeof(engine->last));
+    return engine->rule_count;
+}
+
+int rules_load(RuleEngine *engine, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+    long size = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+    if (size < 0 || fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file); // A pipe or a FIFO has no size to read up front
+        return -1;
+    }
+
+    char *text = malloc(size + 1);
+    if (!text) {
+        fclose(file);
+        return -1;
+    }
+    size_t read = fread(text, 1, size, file);
+    text[read] = '\0';
+    fclose(file);
+
+    int result = rules_compile(engine, text);
+    free(text);
+    return result;
+}
+
+static int term_update(const RuleTerm *term, int state, int value, float rate, int have_rate) {
+    switch (term->kind) {
+    case TERM_BELOW:
+        return state ? value < term->threshold + term->hysteresis : value < term->threshold;
+    case TERM_ABOVE:
+        return state ? value > term->threshold - term->hysteresis : value > term->threshold;
+    case TERM_RATE_ABOVE:
+        return have_rate && rate > term->threshold;
+    case TERM_RATE_BELOW:
+        return have_rate && rate < term->threshold;
+    }
+    return 0;
+}
+
+static int rule_condition(const RuleEngine *engine, const Rule *rule) {
+    const RuleTerm *term = &engine->terms[rule->term_first];
+    for (int i = 0; i < rule->term_count; i++) {
+        int state = atomic_load_explicit(&term[i].state, memory_order_relaxed);
+        if (rule->any && state) {
+            return 1;
+        }
+        if (!rule->any && !state) {
+            return 0;
+        }
+    }
+    return !rule->any;
+}
+
+int rules_eval(RuleEngine *engine, const Sample *sample) {
+    if (sample->sensor >= SENSOR_COUNT) {
+        return 0;
+    }
+
+    // Rate since the previous sample of this sensor, in units per second
+    int value = sample->value;
+    float rate = 0;
+    int have_rate = 0;
+    if (engine->last[sample->sensor].valid && sample->ts_ns > engine->last[sample->sensor].ts_ns) {
+        rate = (float)(value - engine->last[sample->sensor].value) * 1e9f /
+               (float)(sample->ts_ns - engine->last[sample->sensor].ts_ns);
+        have_rate = 1;
+    }
+    engine->last[sample->sensor].ts_ns = sample->ts_ns;
+    engine->last[sample->sensor].value = value;
+    engine->last[sample->sensor].valid = 1;
+
+    // All of this sensor's terms first, so a rule with several terms on it sees the new sample in each
+    int first = engine->sensor_first[sample->sensor];
+    int end = engine->sensor_first[sample->sensor + 1];
+    for (int i = first; i < end; i++) {
+        RuleTerm *term = &engine->terms[engine->by_sensor[i]];
+        int state = atomic_load_explicit(&term->state, memory_order_relaxed);
+        atomic_store_explicit(&term->state, term_update(term, state, value, rate, have_rate), memory_order_relaxed);
+    }
+
+    // Then each affected rule once. Terms are grouped by sensor in index order and a rule's terms
+    // are contiguous, so its terms on this sensor are adjacent here.
+    int fired = 0;
+    for (int i = first; i < end; i++) {
+        int rule_index = engine->terms[engine->by_sensor[i]].rule;
+        if (i > first && engine->terms[engine->by_sensor[i - 1]].rule == rule_index) {
+            continue;
+        }
+
+        // Edge-triggered: only the thread that flips the rule to active runs the action
+        Rule *rule = &engine->rules[rule_index];
+        int condition = rule_condition(engine, rule);
+        if (atomic_exchange(&rule->active, condition) == 0 && condition) {
+            atomic_fetch_add(&rule->fired, 1);
+            if (engine->action) {
+                engine->action(rule, sample, engine->ctx);
+            }
+            fired++;
+        }
+    }
+    return fired;
+}
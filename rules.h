@@ -0,0 +1,91 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "sample.h"
+
+/*
+ * Closed-loop rules evaluated on every sample the gateway ingests.
+ *
+ * Rules are compiled once from text into a flat table, one rule per line:
+ *
+ *   <name> <term> [and|or <term> ...] -> <action>
+ *
+ *   term:   <sensor> < <value> [hyst <n>]      below, stays true until >= value + n
+ *           <sensor> > <value> [hyst <n>]      above, stays true until <= value - n
+ *           <sensor> rate > <units per second> rising faster than
+ *           <sensor> rate < <units per second> falling faster than (use a negative value)
+ *   sensor: humidity | saltiness | light
+ *   action: pump_on | pump_off | pump_toggle | alert
+ *
+ * A rule mixes either "and" or "or", not both. It fires once when its
+ * condition turns true and re-arms when the condition turns false again.
+ * Terms are indexed by sensor, so a sample only touches the rules that
+ * reference its sensor.
+ */
+
+#define RULES_MAX 64
+#define RULE_TERMS_MAX 4
+#define RULE_NAME_LEN 24
+
+typedef enum {
+    TERM_BELOW = 0,
+    TERM_ABOVE,
+    TERM_RATE_ABOVE,
+    TERM_RATE_BELOW
+} TermKind;
+
+typedef enum {
+    ACTION_PUMP_ON = 0,
+    ACTION_PUMP_OFF,
+    ACTION_PUMP_TOGGLE,
+    ACTION_ALERT
+} ActionKind;
+
+typedef struct {
+    float threshold;
+    float hysteresis;
+    uint16_t rule;        // Owning rule
+    uint8_t sensor;       // SensorId
+    uint8_t kind;         // TermKind
+    atomic_uchar state;   // Current truth value, written only by the sensor's thread
+} RuleTerm;
+
+typedef struct {
+    char name[RULE_NAME_LEN];
+    uint16_t term_first;  // Terms of a rule are contiguous in RuleEngine.terms
+    uint8_t term_count;
+    uint8_t any;          // 1 for "or", 0 for "and"
+    uint8_t action;       // ActionKind
+    atomic_uchar active;  // Condition value at the last evaluation
+    atomic_uint fired;    // Number of times the action ran
+} Rule;
+
+typedef void (*RuleActionFn)(const Rule *rule, const Sample *sample, void *ctx);
+
+typedef struct {
+    Rule rules[RULES_MAX];
+    int rule_count;
+    RuleTerm terms[RULES_MAX * RULE_TERMS_MAX];
+    int term_count;
+    uint16_t by_sensor[RULES_MAX * RULE_TERMS_MAX];  // Term indexes grouped by sensor
+    uint16_t sensor_first[SENSOR_COUNT + 1];         // by_sensor range of each sensor
+    struct {
+        uint64_t ts_ns;
+        int value;
+        int valid;
+    } last[SENSOR_COUNT];                            // Previous sample for rate terms
+    RuleActionFn action;
+    void *ctx;
+} RuleEngine;
+
+void rules_init(RuleEngine *engine, RuleActionFn action, void *ctx);
+int rules_compile(RuleEngine *engine, const char *text); // Returns the rule count, -1 on a syntax error
+int rules_load(RuleEngine *engine, const char *path);    // rules_compile() on a file's contents
+int rules_eval(RuleEngine *engine, const Sample *sample); // Returns the number of actions fired
+const char *rules_action_name(int action);
+int sensor_from_name(const char *name);                  // SensorId or -1
+const char *sensor_to_name(int sensor);
+
+#endif /* RULES_H */
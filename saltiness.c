@@ -11,9 +11,11 @@
 #include <linux/ktime.h>
 #include <linux/platform_device.h>
 #include <linux/of.h>
+#include "frame_decode.h"
 
-#define TIME_SLOT_MS 50
-#define DEBOUNCE_TIME_MS 200 // Debounce time in milliseconds
+#define TIME_SLOT_MS 50 // Default bit slot, DT "time-slot-ms"
+#define DEBOUNCE_TIME_MS 200 // Default debounce time in milliseconds, DT "debounce-ms"
+#define TIMING_MAX_MS 10000
 
 static int irq_number;
 static char value;
@@ -24,26 +26,35 @@ static struct workqueue_struct *wq;
 static struct work_struct work;
 static unsigned long last_interrupt_time = 0;
 static int GPIO_PIN; // Declare GPIO_PIN without initialization
+static unsigned int time_slot_ms = TIME_SLOT_MS; // Adjustable live through sysfs
+static unsigned int debounce_ms = DEBOUNCE_TIME_MS;
+
+static int read_line(void *ctx) {
+    return gpio_get_value(GPIO_PIN);
+}
+
+// msleep() rounds up to jiffies, short slots need the hrtimer based sleep
+static void slot_sleep(void *ctx, unsigned int slot_ms) {
+    if (slot_ms < 20) {
+        usleep_range(slot_ms * 1000, slot_ms * 1000 + 100);
+    } else {
+        msleep(slot_ms);
+    }
+}
 
 static void work_handler(struct work_struct *work) {
-    int i;
-    char bits[4] = {0};
+    unsigned int slot_ms = READ_ONCE(time_slot_ms); // One slot length for the whole frame
     struct timespec64 start_time, end_time;
     s64 elapsed_time_ms;
 
     ktime_get_real_ts64(&start_time); // Get the current time
 
-    for (i = 0; i < 4; i++) {       
-        bits[i] = gpio_get_value(GPIO_PIN); // Read the GPIO value
-       // printk(KERN_INFO "saltiness GPIO bit %d : %c\n", i, bits[i] ? '1' : '0');
-        msleep(TIME_SLOT_MS); // Wait for each subsequent time slot
-    }
+    value = frame_decode(read_line, slot_sleep, NULL, slot_ms);
 
     ktime_get_real_ts64(&end_time); // Get the end time
     elapsed_time_ms = (end_time.tv_sec - start_time.tv_sec) * 1000 +
                       (end_time.tv_nsec - start_time.tv_nsec) / 1000000;
 
-    value = (bits[3] << 3) | (bits[2] << 2) | (bits[1] << 1) | bits[0];
     changed_value = 1; // Set the changed_value flag
     printk(KERN_INFO "saltiness combined value: %d\n", value);
 }
@@ -52,7 +63,7 @@ static irqreturn_t gpio_irq_handler(int irq, void *dev_id) {
     unsigned long current_time = jiffies;
     unsigned long time_diff = current_time - last_interrupt_time;
 
-    if (time_diff < msecs_to_jiffies(DEBOUNCE_TIME_MS)) {
+    if (time_diff < msecs_to_jiffies(READ_ONCE(debounce_ms))) {
         return IRQ_HANDLED; // Ignore the interrupt if it's within the debounce period
     }
 
@@ -76,8 +87,40 @@ static ssize_t changed_value_store(struct device* dev, struct device_attribute*
     return count; // Return count to indicate number of bytes written
 }
 
+static ssize_t timing_store(const char* buf, size_t count, unsigned int min, unsigned int* target) {
+    unsigned int ms;
+    int result = kstrtouint(buf, 10, &ms);
+
+    if (result) {
+        return result;
+    }
+    if (ms < min || ms > TIMING_MAX_MS) {
+        return -EINVAL;
+    }
+    WRITE_ONCE(*target, ms);
+    return count;
+}
+
+static ssize_t time_slot_ms_show(struct device* dev, struct device_attribute* attr, char* buf) {
+    return sprintf(buf, "%u\n", READ_ONCE(time_slot_ms));
+}
+
+static ssize_t time_slot_ms_store(struct device* dev, struct device_attribute* attr, const char* buf, size_t count) {
+    return timing_store(buf, count, 1, &time_slot_ms); // Takes effect with the next frame
+}
+
+static ssize_t debounce_ms_show(struct device* dev, struct device_attribute* attr, char* buf) {
+    return sprintf(buf, "%u\n", READ_ONCE(debounce_ms));
+}
+
+static ssize_t debounce_ms_store(struct device* dev, struct device_attribute* attr, const char* buf, size_t count) {
+    return timing_store(buf, count, 0, &debounce_ms);
+}
+
 static DEVICE_ATTR(value, 0444, value_show, NULL);
 static DEVICE_ATTR(changed_value, 0644, changed_value_show, changed_value_store);
+static DEVICE_ATTR(time_slot_ms, 0644, time_slot_ms_show, time_slot_ms_store);
+static DEVICE_ATTR(debounce_ms, 0644, debounce_ms_show, debounce_ms_store);
 
 static int gpio_saltiness_probe(struct platform_device *pdev) {
     struct device *dev = &pdev->dev;
@@ -106,6 +149,16 @@ static int gpio_saltiness_probe(struct platform_device *pdev) {
         return result;
     }
 
+    // Optional timing overrides, the defaults apply when a property is missing
+    time_slot_ms = TIME_SLOT_MS;
+    debounce_ms = DEBOUNCE_TIME_MS;
+    of_property_read_u32(dev->of_node, "time-slot-ms", &time_slot_ms);
+    of_property_read_u32(dev->of_node, "debounce-ms", &debounce_ms);
+    if (time_slot_ms < 1 || time_slot_ms > TIMING_MAX_MS || debounce_ms > TIMING_MAX_MS) {
+        dev_err(dev, "Invalid time-slot-ms %u or debounce-ms %u in device tree\n", time_slot_ms, debounce_ms);
+        return -EINVAL;
+    }
+
     // Create class
     gpio_class = class_create(THIS_MODULE, class_name);
     if (IS_ERR(gpio_class)) {
@@ -138,6 +191,22 @@ static int gpio_saltiness_probe(struct platform_device *pdev) {
         return result;
     }
 
+    result = device_create_file(gpio_device, &dev_attr_time_slot_ms);
+    if (!result) {
+        result = device_create_file(gpio_device, &dev_attr_debounce_ms);
+        if (result) {
+            device_remove_file(gpio_device, &dev_attr_time_slot_ms);
+        }
+    }
+    if (result) {
+        device_remove_file(gpio_device, &dev_attr_changed_value);
+        device_remove_file(gpio_device, &dev_attr_value);
+        device_destroy(gpio_class, 0);
+        class_destroy(gpio_class);
+        dev_err(dev, "Failed to create timing device files\n");
+        return result;
+    }
+
     gpio_request(GPIO_PIN, "sysfs");
     gpio_direction_input(GPIO_PIN);
     irq_number = gpio_to_irq(GPIO_PIN);
@@ -161,6 +230,8 @@ static int gpio_saltiness_remove(struct platform_device *pdev) {
     free_irq(irq_number, NULL);
     gpio_free(GPIO_PIN);
     destroy_workqueue(wq);
+    device_remove_file(gpio_device, &dev_attr_debounce_ms);
+    device_remove_file(gpio_device, &dev_attr_time_slot_ms);
     device_remove_file(gpio_device, &dev_attr_changed_value);
     device_remove_file(gpio_device, &dev_attr_value);
     device_destroy(gpio_class, 0);
@@ -0,0 +1,29 @@
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <stdint.h>
+
+// Sensors known to the gateway, in the order the MCU sends them
+typedef enum {
+    SENSOR_HUMIDITY = 0,
+    SENSOR_SALTINESS,
+    SENSOR_LIGHT,
+    SENSOR_COUNT
+} SensorId;
+
+// Which path a sample arrived on
+typedef enum {
+    ORIGIN_GPIO = 0, // Decoded from the sensor lines on this board
+    ORIGIN_MCU       // Reported by the MCU over UDP ("fetch")
+} SampleOrigin;
+
+// One decoded reading as it moves through the gateway
+typedef struct {
+    uint64_t ts_ns;  // CLOCK_MONOTONIC time the value was captured
+    uint32_t seq;    // Per-sensor sequence number
+    uint8_t sensor;  // SensorId
+    uint8_t value;   // 4-bit sensor value
+    uint8_t origin;  // SampleOrigin
+} Sample;
+
+#endif /* SAMPLE_H */
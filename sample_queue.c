@@ -0,0 +1,107 @@
+#include <stdlib.h>
+#include <sched.h>
+#include "sample_queue.h"
+
+int queue_init(SampleQueue *queue, size_t capacity, QueuePolicy policy) {
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    queue->cells = malloc(size * sizeof(QueueCell));
+    if (!queue->cells) {
+        return -1;
+    }
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&queue->cells[i].seq, i);
+    }
+    queue->mask = size - 1;
+    queue->policy = policy;
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    atomic_init(&queue->pushed, 0);
+    atomic_init(&queue->dropped, 0);
+    atomic_init(&queue->blocked, 0);
+    return 0;
+}
+
+void queue_destroy(SampleQueue *queue) {
+    free(queue->cells);
+    queue->cells = NULL;
+}
+
+void queue_reset_counters(SampleQueue *queue) {
+    atomic_store(&queue->pushed, 0);
+    atomic_store(&queue->dropped, 0);
+    atomic_store(&queue->blocked, 0);
+}
+
+// Claim the oldest cell. Used by the writer and, for drop-oldest, by a producer facing a full queue.
+static int queue_pop(SampleQueue *queue, Sample *out) {
+    size_t pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    for (;;) {
+        QueueCell *cell = &queue->cells[pos & queue->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                if (out) {
+                    *out = cell->sample;
+                }
+                atomic_store_explicit(&cell->seq, pos + queue->mask + 1, memory_order_release);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0; // Empty
+        } else {
+            pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        }
+    }
+}
+
+void queue_push(SampleQueue *queue, const Sample *sample) {
+    size_t pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    int waited = 0;
+
+    for (;;) {
+        QueueCell *cell = &queue->cells[pos & queue->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                cell->sample = *sample;
+                atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+                atomic_fetch_add_explicit(&queue->pushed, 1, memory_order_relaxed);
+                return;
+            }
+        } else if (diff < 0) {
+            // Full: make room by discarding the oldest sample, or wait for the writer
+            if (queue->policy == QUEUE_DROP_OLDEST) {
+                if (queue_pop(queue, NULL)) {
+                    atomic_fetch_add_explicit(&queue->dropped, 1, memory_order_relaxed);
+                }
+            } else {
+                if (!waited) {
+                    atomic_fetch_add_explicit(&queue->blocked, 1, memory_order_relaxed);
+                    waited = 1;
+                }
+                sched_yield();
+            }
+            pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+        } else {
+            pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+        }
+    }
+}
+
+size_t queue_pop_batch(SampleQueue *queue, Sample *out, size_t max) {
+    size_t count = 0;
+    while (count < max && queue_pop(queue, &out[count])) {
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,43 @@
+#ifndef SAMPLE_QUEUE_H
+#define SAMPLE_QUEUE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include "sample.h"
+
+/*
+ * Bounded lock-free queue carrying Samples from the per-sensor ingestion
+ * threads to the single writer thread. Each cell carries a sequence number
+ * (Vyukov's bounded queue), so producers never take a lock and the writer
+ * drains whole batches. When the queue is full the policy decides whether
+ * the producer discards the oldest queued sample or waits for room.
+ */
+
+typedef enum {
+    QUEUE_DROP_OLDEST = 0,
+    QUEUE_BLOCK
+} QueuePolicy;
+
+typedef struct {
+    atomic_size_t seq;
+    Sample sample;
+} QueueCell;
+
+typedef struct {
+    QueueCell *cells;
+    size_t mask;
+    QueuePolicy policy;
+    _Alignas(64) atomic_size_t head;  // Next cell to pop
+    _Alignas(64) atomic_size_t tail;  // Next cell to push
+    _Alignas(64) atomic_ulong pushed;
+    atomic_ulong dropped;             // Oldest samples discarded on overflow
+    atomic_ulong blocked;             // Pushes that had to wait for room
+} SampleQueue;
+
+int queue_init(SampleQueue *queue, size_t capacity, QueuePolicy policy); // capacity is rounded up to a power of two
+void queue_destroy(SampleQueue *queue);
+void queue_reset_counters(SampleQueue *queue); // Zero pushed/dropped/blocked, call while nothing pushes
+void queue_push(SampleQueue *queue, const Sample *sample);
+size_t queue_pop_batch(SampleQueue *queue, Sample *out, size_t max);
+
+#endif /* SAMPLE_QUEUE_H */
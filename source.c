@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include "source.h"
+#include "rules.h"
+
+#define SYSFS_POLL_MS 100 // changed_value cannot be poll()ed, it is re-read at this period
+
+static uint64_t monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+void source_close(SensorSource *source) {
+    if (source) {
+        source->close(source);
+    }
+}
+
+void trace_write(FILE *trace, const Sample *sample) {
+    fprintf(trace, "%llu %u %s %u\n", (unsigned long long)sample->ts_ns, sample->seq,
+            sensor_to_name(sample->sensor), sample->value);
+}
+
+/* ---- Live sensor module: value + changed_value sysfs attributes ---- */
+
+typedef struct {
+    int value_fd;
+    int changed_fd;
+    SensorId sensor;
+    uint32_t seq;
+} SysfsSource;
+
+static int sysfs_next(SensorSource *source, Sample *sample) {
+    SysfsSource *sysfs = source->priv;
+    char changed[8] = {0}, value[8] = {0};
+
+    // sysfs regenerates the attribute on every read at offset 0, so the files stay open
+    if (pread(sysfs->changed_fd, changed, sizeof(changed) - 1, 0) <= 0) {
+        return SOURCE_END;
+    }
+    if (strcmp(changed, "1\n") != 0) {
+        struct timespec period = {0, SYSFS_POLL_MS * 1000000L};
+        nanosleep(&period, NULL);
+        return SOURCE_IDLE;
+    }
+    if (pread(sysfs->value_fd, value, sizeof(value) - 1, 0) <= 0) {
+        return SOURCE_END;
+    }
+    if (pwrite(sysfs->changed_fd, "0", 1, 0) != 1) {
+        fprintf(stderr, "Error: Failed to reset changed_value for %s\n", sensor_to_name(sysfs->sensor));
+    }
+
+    sample->ts_ns = monotonic_ns();
+    sample->seq = sysfs->seq++;
+    sample->sensor = sysfs->sensor;
+    sample->value = (uint8_t)atoi(value);
+    sample->origin = ORIGIN_GPIO;
+    return SOURCE_SAMPLE;
+}
+
+static void sysfs_close(SensorSource *source) {
+    SysfsSource *sysfs = source->priv;
+    close(sysfs->value_fd);
+    close(sysfs->changed_fd);
+    free(sysfs);
+    free(source);
+}
+
+SensorSource *source_sysfs_open(const char *device_path, SensorId sensor) {
+    char value_path[256], changed_value_path[256];
+    snprintf(value_path, sizeof(value_path), "%svalue", device_path);
+    snprintf(changed_value_path, sizeof(changed_value_path), "%schanged_value", device_path);
+
+    SensorSource *source = calloc(1, sizeof(*source));
+    SysfsSource *sysfs = calloc(1, sizeof(*sysfs));
+    if (!source || !sysfs) {
+        free(source);
+        free(sysfs);
+        return NULL;
+    }
+
+    sysfs->value_fd = open(value_path, O_RDONLY);
+    sysfs->changed_fd = open(changed_value_path, O_RDWR);
+    if (sysfs->value_fd < 0 || sysfs->changed_fd < 0) {
+        fprintf(stderr, "Error: Failed to open sysfs files for %s: %s\n", sensor_to_name(sensor), strerror(errno));
+        if (sysfs->value_fd >= 0) close(sysfs->value_fd);
+        if (sysfs->changed_fd >= 0) close(sysfs->changed_fd);
+        free(sysfs);
+        free(source);
+        return NULL;
+    }
+
+    sysfs->sensor = sensor;
+    source->next = sysfs_next;
+    source->close = sysfs_close;
+    source->priv = sysfs;
+    return source;
+}
+
+/* ---- Recorded trace ---- */
+
+typedef struct {
+    FILE *file;
+    int realtime;
+    int started;
+    uint64_t first_ts_ns;  // Trace time of the first sample
+    uint64_t start_ns;     // Monotonic time the replay started
+} TraceSource;
+
+static int trace_next(SensorSource *source, Sample *sample) {
+    TraceSource *trace = source->priv;
+    char line[128], name[32];
+    unsigned long long ts_ns;
+    unsigned seq, value;
+
+    while (fgets(line, sizeof(line), trace->file)) {
+        if (sscanf(line, "%llu %u %31s %u", &ts_ns, &seq, name, &value) != 4) {
+            continue; // Comment or damaged line
+        }
+        int sensor = sensor_from_name(name);
+        if (sensor < 0) {
+            continue;
+        }
+
+        if (!trace->started) {
+            trace->started = 1;
+            trace->first_ts_ns = ts_ns;
+            trace->start_ns = monotonic_ns();
+        }
+        if (trace->realtime && ts_ns > trace->first_ts_ns) {
+            uint64_t due = trace->start_ns + (ts_ns - trace->first_ts_ns);
+            struct timespec wake = {(time_t)(due / 1000000000ull), (long)(due % 1000000000ull)};
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+        }
+
+        sample->ts_ns = ts_ns;
+        sample->seq = seq;
+        sample->sensor = (uint8_t)sensor;
+        sample->value = (uint8_t)value;
+        sample->origin = ORIGIN_GPIO;
+        return SOURCE_SAMPLE;
+    }
+    return SOURCE_END;
+}
+
+static void trace_close(SensorSource *source) {
+    TraceSource *trace = source->priv;
+    fclose(trace->file);
+    free(trace);
+    free(source);
+}
+
+SensorSource *source_trace_open(const char *path, int realtime) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Error: Failed to open trace %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    SensorSource *source = calloc(1, sizeof(*source));
+    TraceSource *trace = calloc(1, sizeof(*trace));
+    if (!source || !trace) {
+        fclose(file);
+        free(source);
+        free(trace);
+        return NULL;
+    }
+
+    trace->file = file;
+    trace->realtime = realtime;
+    source->next = trace_next;
+    source->close = trace_close;
+    source->priv = trace;
+    return source;
+}
+
+/* ---- Fault injection ---- */
+
+#define FAULT_PENDING_MAX 4
+
+typedef struct {
+    SensorSource *inner;
+    FaultConfig config;
+    FaultCounters *counters;
+    unsigned rng;
+    Sample pending[FAULT_PENDING_MAX]; // Samples owed to the caller, oldest first
+    int pending_count;
+    Sample held;                       // Delayed sample waiting for its successor
+    int holding;
+    uint8_t last_value[SENSOR_COUNT];
+    uint8_t have_last[SENSOR_COUNT];
+} FaultSource;
+
+static int chance(FaultSource *fault, double probability) {
+    // xorshift32, deterministic for a given seed so incidents can be replayed exactly
+    fault->rng ^= fault->rng << 13;
+    fault->rng ^= fault->rng >> 17;
+    fault->rng ^= fault->rng << 5;
+    return probability > 0 && (fault->rng / 4294967296.0) < probability;
+}
+
+static void push_pending(FaultSource *fault, const Sample *sample) {
+    if (fault->pending_count < FAULT_PENDING_MAX) {
+        fault->pending[fault->pending_count++] = *sample;
+    }
+}
+
+static int pop_pending(FaultSource *fault, Sample *sample) {
+    if (fault->pending_count == 0) {
+        return 0;
+    }
+    *sample = fault->pending[0];
+    memmove(fault->pending, fault->pending + 1, (fault->pending_count - 1) * sizeof(Sample));
+    fault->pending_count--;
+    return 1;
+}
+
+static int fault_next(SensorSource *source, Sample *sample) {
+    FaultSource *fault = source->priv;
+    Sample current;
+
+    if (pop_pending(fault, sample)) {
+        return SOURCE_SAMPLE;
+    }
+
+    int result = fault->inner->next(fault->inner, &current);
+    if (result != SOURCE_SAMPLE) {
+        if (result == SOURCE_END && fault->holding) {
+            fault->holding = 0;
+            *sample = fault->held;
+            return SOURCE_SAMPLE;
+        }
+        return result;
+    }
+
+    if (chance(fault, fault->config.drop)) {
+        fault->counters->dropped++;
+        return SOURCE_IDLE;
+    }
+    if (chance(fault, fault->config.bit_flip)) {
+        current.value ^= (uint8_t)(1u << (fault->rng % 4));
+        fault->counters->flipped++;
+    }
+
+    uint8_t previous = fault->last_value[current.sensor];
+    int had_previous = fault->have_last[current.sensor];
+    fault->last_value[current.sensor] = current.value;
+    fault->have_last[current.sensor] = 1;
+
+    // Reordering: the sample comes out after its successor, stamped delay_ms late. The stamp is
+    // all delay_ms changes, even in realtime replay the sample is not held for that long.
+    if (!fault->holding && chance(fault, fault->config.delay)) {
+        fault->held = current;
+        fault->held.ts_ns += (uint64_t)fault->config.delay_ms * 1000000ull;
+        fault->holding = 1;
+        fault->counters->delayed++;
+        return SOURCE_IDLE;
+    }
+
+    // What the caller sees, in order: stale repeat, the sample, its duplicate, a released delayed sample
+    if (had_previous && chance(fault, fault->config.stuck)) {
+        Sample repeat = current;
+        repeat.value = previous;
+        push_pending(fault, &repeat);
+        fault->counters->stuck++;
+    }
+    push_pending(fault, &current);
+    if (chance(fault, fault->config.duplicate)) {
+        push_pending(fault, &current);
+        fault->counters->duplicated++;
+    }
+    if (fault->holding) {
+        push_pending(fault, &fault->held);
+        fault->holding = 0;
+    }
+
+    fault->counters->passed++;
+    pop_pending(fault, sample);
+    return SOURCE_SAMPLE;
+}
+
+static void fault_close(SensorSource *source) {
+    FaultSource *fault = source->priv;
+    source_close(fault->inner);
+    free(fault);
+    free(source);
+}
+
+SensorSource *source_fault_wrap(SensorSource *inner, const FaultConfig *config, FaultCounters *counters) {
+    SensorSource *source = calloc(1, sizeof(*source));
+    FaultSource *fault = calloc(1, sizeof(*fault));
+    if (!source || !fault) {
+        free(source);
+        free(fault);
+        return NULL;
+    }
+
+    fault->inner = inner;
+    fault->config = *config;
+    fault->counters = counters;
+    fault->rng = config->seed ? config->seed : 1;
+    source->next = fault_next;
+    source->close = fault_close;
+    source->priv = fault;
+    return source;
+}
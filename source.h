@@ -0,0 +1,53 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdio.h>
+#include "sample.h"
+
+/*
+ * Where the gateway gets its samples from. The live path polls the sensor
+ * modules' sysfs attributes; replay reads a recorded trace. A fault source
+ * wraps either one to drop, duplicate, delay, corrupt or repeat samples.
+ *
+ * Trace format, one sample per line: "<ts_ns> <seq> <sensor name> <value>"
+ */
+
+#define SOURCE_SAMPLE 1 // next() produced a sample
+#define SOURCE_IDLE 0   // Nothing new yet, poll again. Live sources wait for input before saying so
+#define SOURCE_END -1   // End of trace or unrecoverable error
+
+typedef struct SensorSource SensorSource;
+struct SensorSource {
+    int (*next)(SensorSource *source, Sample *sample);
+    void (*close)(SensorSource *source);
+    void *priv;
+};
+
+typedef struct {
+    double drop;       // Probability a sample is lost
+    double duplicate;  // Probability a sample is delivered twice
+    double delay;      // Probability a sample is held back and delivered right after the next one
+    unsigned delay_ms; // Added to a delayed sample's ts_ns only, its delivery is not held back any longer
+    double bit_flip;   // Probability one value bit is inverted
+    double stuck;      // Probability the previous value is re-reported as a new sample
+    unsigned seed;
+} FaultConfig;
+
+typedef struct {
+    unsigned long passed;
+    unsigned long dropped;
+    unsigned long duplicated;
+    unsigned long delayed;
+    unsigned long flipped;
+    unsigned long stuck;
+} FaultCounters;
+
+SensorSource *source_sysfs_open(const char *device_path, SensorId sensor);
+SensorSource *source_trace_open(const char *path, int realtime); // realtime: honour recorded gaps
+// NULL if out of memory, inner is then still the caller's to close
+SensorSource *source_fault_wrap(SensorSource *inner, const FaultConfig *config, FaultCounters *counters);
+void source_close(SensorSource *source);
+
+void trace_write(FILE *trace, const Sample *sample);
+
+#endif /* SOURCE_H */